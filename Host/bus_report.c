@@ -0,0 +1,157 @@
+/**
+ ******************************************************************************
+ * @file    bus_report.c
+ * @brief   Bus bytes per frame with and without run merging
+ ******************************************************************************
+ *
+ * Replays the recorded gameplay frames (frames.h, default frames.bin)
+ * through LCD_SwapBuffers() four times: CPU and DMA flush, each with run
+ * merging off (no cost for re-addressing, so no gap is ever worth
+ * resending) and with the default cost model. For every pass it reports
+ * - what the controller model counted on the bus: command and data bytes
+ *   and bus time per frame
+ * - the merge statistics (LCD_GetMergeStats()): runs found by the diff and
+ *   runs sent, and the address + data bytes the merger estimated for each
+ * and checks that the panel shows the last frame, that the merger's
+ * estimate of the bytes sent is what the model counted and that no access
+ * broke the controller's timing. HCLK is 72 MHz, as in the game. The merge line of
+ * LCD_DumpTrafficStats() is printed too, as the board would send it.
+ *
+ *   ./bus_report [frames.bin]
+ *
+ * Exit status 0 -- ok, 1 -- the recording did not load or a check failed.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "frames.h"
+
+typedef struct {
+  const char *name;
+  unsigned char mode;
+  unsigned char merge;
+} ReportPass;
+
+static const ReportPass passes[] = {
+  {"cpu, merging off", LCD_FLUSH_MODE_CPU, 0},
+  {"cpu, merging on ", LCD_FLUSH_MODE_CPU, 1},
+  {"dma, merging off", LCD_FLUSH_MODE_DMA, 0},
+  {"dma, merging on ", LCD_FLUSH_MODE_DMA, 1}
+};
+
+/*******************************************************************************
+* Function Name  : WriteMergeLine
+* Description    : LCD_DumpTrafficStats() writer that prints the merge line
+*******************************************************************************/
+static void WriteMergeLine(const char *text, unsigned int length)
+{
+  if (length > 6 && strncmp(text, "merge ", 6) == 0) {
+    printf("    dump: %.*s\n", (int)(length - 2), text);   // Without the CR LF
+  }
+}
+
+/*******************************************************************************
+* Function Name  : PanelMatches
+* Description    : The model's panel against frameBuffer, pixel by pixel
+*******************************************************************************/
+static int PanelMatches(void)
+{
+  unsigned char x, y;
+
+  for (y = 0; y < LCD_HEIGHT; y++) {
+    for (x = 0; x < LCD_WIDTH; x++) {
+      unsigned char expect = (frameBuffer[(y >> 3) * LCD_WIDTH + x] >> (y & 7)) & 1;
+      if (LCD_Emu_GetPixel(x, y) != expect) return 0;
+    }
+  }
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : RunPass
+* Description    : Replay the recording in one flush mode / merge setting
+* Return         : 0 -- checks passed, 1 -- a failure was printed
+*******************************************************************************/
+static int RunPass(const Recording *rec, const ReportPass *pass)
+{
+  LCD_EmuStats start, end;
+  LCD_MergeStats merge;
+  unsigned int i;
+  double frames = rec->count - 1;
+
+  LCD_Emu_Reset();
+  LCD_Init();
+  LCD_Clear();            // As main.c: the panel RAM starts undefined
+  LCD_InitFrameBuffer();
+  LCD_InitDMA();
+  LCD_SetFlushMode(pass->mode);
+  if (pass->merge) {
+    LCD_SetFlushCostModel(LCD_COST_CMD_DEFAULT, LCD_COST_DATA_DEFAULT, LCD_COST_RUN_DMA_DEFAULT);
+  } else {
+    LCD_SetFlushCostModel(0, LCD_COST_DATA_DEFAULT, 0);
+  }
+
+  // First frame sent whole; the pairs after it are what gets measured
+  Frames_Apply(&rec->frame[0]);
+  LCD_FlushBuffer();
+  LCD_WaitFlush();
+  LCD_Emu_EndFrame();
+  LCD_ResetMergeStats();
+  LCD_Emu_GetTotalStats(&start);
+
+  for (i = 1; i < rec->count; i++) {
+    Frames_Apply(&rec->frame[i]);
+    LCD_SwapBuffers();
+    LCD_WaitFlush();
+    LCD_Emu_EndFrame();
+  }
+  LCD_Emu_GetTotalStats(&end);
+  LCD_GetMergeStats(&merge);
+
+  printf("  %s : %6.1f cmd %6.1f data %7.2f us  | runs %6.2f > %6.2f  est. bytes %6.1f > %6.1f\n",
+         pass->name,
+         (end.cmdBytes - start.cmdBytes) / frames,
+         (end.dataBytes - start.dataBytes) / frames,
+         (end.busNs - start.busNs) / frames / 1000.0,
+         merge.runsBefore / frames, merge.runsAfter / frames,
+         merge.busBytesBefore / frames, merge.busBytesAfter / frames);
+  LCD_DumpTrafficStats(WriteMergeLine);
+
+  if (!PanelMatches()) {
+    printf("  %s : panel differs from the last frame\n", pass->name);
+    return 1;
+  }
+  if (end.cmdBytes - start.cmdBytes + end.dataBytes - start.dataBytes != merge.busBytesAfter) {
+    printf("  %s : merge estimate differs from the bytes on the bus\n", pass->name);
+    return 1;
+  }
+  if (end.timingFaults != 0) {
+    printf("  %s : %lu accesses shorter than t_CYC/t_PW\n", pass->name, end.timingFaults);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = argc > 1 ? argv[1] : "frames.bin";
+  Recording rec;
+  unsigned int p;
+  int failed = 0;
+
+  if (Frames_Load(&rec, path) != 0 || rec.count < 2) {
+    fprintf(stderr, "cannot load %s\n", path);
+    return 1;
+  }
+
+  SystemCoreClock = 72000000;     // CLOCK_PROFILE_DEFAULT
+  printf("%s: %u frames, per frame:\n", path, rec.count);
+  for (p = 0; p < sizeof(passes) / sizeof(passes[0]); p++) {
+    failed |= RunPass(&rec, &passes[p]);
+  }
+
+  Frames_Free(&rec);
+  return failed;
+}
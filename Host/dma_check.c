@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************
+ * @file    dma_check.c
+ * @brief   Host check of the DMA flush: run scheduling and completion order
+ ******************************************************************************
+ *
+ * Builds lcd.c against the DMA stand-in (lcd_host.c) and the controller
+ * model (lcd_emu.c), draws a deterministic sequence of frames and flushes
+ * each one in DMA mode, retiring the queued transfers one at a time with
+ * LCD_Host_DMA_Complete(), the way the DMA2 channel 1 interrupt would. It
+ * checks that:
+ * - the flush reports LCD_FLUSH_BUSY while a transfer is latched and
+ *   LCD_FLUSH_IDLE after the last one, with one flush callback per flush
+ * - every transfer goes to LCD_DATA_ADDR from inside backBuffer, and the
+ *   runs are sent in buffer order without overlapping
+ * - after completion the model's display RAM shows exactly frameBuffer
+ *   (the model is the oracle for what the controller received)
+ * - no access, CPU or DMA, is shorter than the controller's t_CYC/t_PW.
+ *   The frames are split over the clock profiles (8, 36, 64, 72 MHz) with
+ *   LCD_BusTimingInit() redone at each switch, and the model is first shown
+ *   to flag the old fixed timing (ADDSET 1, DATAST 20) at 72 MHz.
+ * Every few frames bytes all over the buffer change, so there are more runs
+ * than LCD_DMA_MAX_RUNS and the CPU fallback is covered too. Every few
+ * frames a pixel is also flipped with LCD_SetPixel() while the flush is
+ * still busy, checked on the panel and put back; the direct draw has to
+ * wait for the flush rather than cut into it.
+ *
+ *   make -C Host check      (or ./dma_check after make -C Host)
+ *
+ * Exit status 0 -- all checks passed, 1 -- a failure was printed.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include "lcd.h"
+
+#define CHECK_FRAMES          2000
+#define CHECK_NOISE_EVERY     25      // Frames between full-screen pixel noise
+#define CHECK_DIRECT_EVERY    7       // Frames between direct draws mid-flush
+
+static const unsigned long checkClocks[] = {8000000, 36000000, 64000000, 72000000};
+#define CHECK_CLOCKS          (sizeof(checkClocks) / sizeof(checkClocks[0]))
+
+static unsigned long checkRandom = 1;
+static unsigned int flushCallbacks = 0;
+static unsigned int failures = 0;
+
+/*******************************************************************************
+* Function Name  : CheckRand
+* Description    : Small LCG, so the frame sequence is the same on every run
+*******************************************************************************/
+static unsigned int CheckRand(unsigned int range)
+{
+  checkRandom = checkRandom * 1103515245UL + 12345UL;
+  return (unsigned int)((checkRandom >> 16) & 0x7FFF) % range;
+}
+
+/*******************************************************************************
+* Function Name  : CheckFail
+* Description    : Report one failed check (the first few only)
+*******************************************************************************/
+static void CheckFail(unsigned int frame, const char *what)
+{
+  if (failures++ < 10) {
+    printf("frame %u: %s\n", frame, what);
+  }
+}
+
+static void OnFlushDone(void)
+{
+  flushCallbacks++;
+}
+
+/*******************************************************************************
+* Function Name  : DrawFrame
+* Description    : Game-like changes: a dino moving up and down, obstacles
+*                  stepping left, the odd score digit, and now and then
+*                  noise over the whole screen
+*******************************************************************************/
+static void DrawFrame(unsigned int frame)
+{
+  static signed short obstacle[3] = {120, 80, 40};
+  unsigned char i;
+
+  LCD_Buffer_FillRect(8, 16, 23, 55, 0);
+  LCD_Buffer_DrawSprite(16 + CheckRand(25), 8, 125 + 2 * (frame / 4 % 3), 2);
+
+  for (i = 0; i < 3; i++) {
+    LCD_Buffer_FillRect(obstacle[i] < 0 ? 0 : obstacle[i], 40, obstacle[i] + 15, 55, 0);
+    obstacle[i] -= 1 + CheckRand(6);
+    if (obstacle[i] < 0) obstacle[i] = LCD_WIDTH - 16;
+    LCD_Buffer_DrawSprite(40, obstacle[i], 120, 2);
+  }
+
+  if (CheckRand(10) == 0) {
+    LCD_Buffer_DrawChar(0, 100, CheckRand(10));
+  }
+
+  if (frame % CHECK_NOISE_EVERY == 0) {
+    // Bytes far enough apart that no two runs merge: well over the run limit
+    unsigned char page, col;
+    for (page = 0; page < LCD_PAGES; page++) {
+      for (col = CheckRand(8); col < LCD_WIDTH; col += 8) {
+        LCD_Buffer_SetByte(page, col, (unsigned char)CheckRand(256));
+      }
+    }
+  }
+}
+
+/*******************************************************************************
+* Function Name  : CheckTransfers
+* Description    : Destination, source range and order of the transfers
+*                  retired for one flush
+*******************************************************************************/
+static void CheckTransfers(unsigned int frame)
+{
+  unsigned int i;
+  const unsigned char *end = backBuffer;
+
+  for (i = 0; i < LCD_Host_DMA_LogCount; i++) {
+    const LCD_HostDMATransfer *t = &LCD_Host_DMA_Log[i];
+
+    if (t->dst != LCD_DATA_ADDR) CheckFail(frame, "transfer not sent to LCD_DATA_ADDR");
+    if (t->src < backBuffer || t->src + t->length > backBuffer + LCD_BUFFER_SIZE) {
+      CheckFail(frame, "transfer source outside backBuffer");
+    }
+    if (t->src < end) CheckFail(frame, "runs out of order or overlapping");
+    if ((t->src - backBuffer) / LCD_WIDTH != (t->src + t->length - 1 - backBuffer) / LCD_WIDTH) {
+      CheckFail(frame, "run crosses a page boundary");
+    }
+    end = t->src + t->length;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : CheckScreen
+* Description    : The model's panel against frameBuffer, pixel by pixel
+*******************************************************************************/
+static void CheckScreen(unsigned int frame)
+{
+  unsigned char x, y;
+
+  for (y = 0; y < LCD_HEIGHT; y++) {
+    for (x = 0; x < LCD_WIDTH; x++) {
+      unsigned char expect = (frameBuffer[(y >> 3) * LCD_WIDTH + x] >> (y & 7)) & 1;
+      if (LCD_Emu_GetPixel(x, y) != expect) {
+        CheckFail(frame, "panel differs from frameBuffer");
+        return;
+      }
+    }
+  }
+}
+
+int main(void)
+{
+  unsigned int frame;
+  unsigned long transfers = 0, overflows = 0, directDraws = 0;
+  LCD_EmuStats stats;
+
+  // The model has to catch a bus that is too fast: 22 HCLK = 305 ns
+  LCD_Emu_Reset();
+  LCD_Emu_SetTiming(1, 20, 72000000);
+  LCD_Emu_WriteCmd(Display_Off);
+  LCD_Emu_EndFrame();
+  LCD_Emu_GetFrameStats(&stats);
+  if (stats.timingFaults != 1) CheckFail(0, "old FSMC timing not flagged at 72 MHz");
+
+  LCD_Emu_Reset();
+  LCD_Init();
+  LCD_Clear();            // As main.c: the panel RAM starts undefined
+  LCD_InitFrameBuffer();
+  LCD_InitDMA();
+  LCD_SetFlushMode(LCD_FLUSH_MODE_DMA);
+  LCD_SetFlushCallback(OnFlushDone);
+
+  for (frame = 0; frame < CHECK_FRAMES; frame++) {
+    unsigned int callbacks = flushCallbacks;
+    unsigned int retired = 0;
+
+    if (frame % (CHECK_FRAMES / CHECK_CLOCKS) == 0) {
+      // A clock switch between frames, as setClockProfile() in main.c
+      SystemCoreClock = checkClocks[frame / (CHECK_FRAMES / CHECK_CLOCKS)];
+      LCD_BusTimingInit();
+    }
+    DrawFrame(frame);
+    LCD_Host_DMA_ResetLog();
+    LCD_SwapBuffers();
+
+    if (frame % CHECK_DIRECT_EVERY == 0 && LCD_Host_DMA_Busy()) {
+      // Flip one pixel on the panel only, then put it back for CheckScreen()
+      unsigned char x = CheckRand(LCD_WIDTH), y = CheckRand(LCD_HEIGHT);
+      unsigned char state = (frameBuffer[(y >> 3) * LCD_WIDTH + x] >> (y & 7)) & 1;
+
+      LCD_SetPixel(x, y, !state);
+      if (LCD_GetFlushStatus() != LCD_FLUSH_IDLE) CheckFail(frame, "direct draw did not wait for the flush");
+      if (LCD_Emu_GetPixel(x, y) == state) CheckFail(frame, "direct draw missed its pixel");
+      LCD_SetPixel(x, y, state);
+      directDraws++;
+    }
+
+    // Retire the queue one transfer at a time, as the interrupt would
+    while (LCD_Host_DMA_Busy()) {
+      if (LCD_GetFlushStatus() != LCD_FLUSH_BUSY) CheckFail(frame, "idle with a transfer latched");
+      if (flushCallbacks != callbacks) CheckFail(frame, "callback before the last transfer");
+      LCD_Host_DMA_Complete();
+      if (++retired > LCD_DMA_MAX_RUNS) {
+        CheckFail(frame, "more transfers than LCD_DMA_MAX_RUNS");
+        break;
+      }
+    }
+    if (LCD_GetFlushStatus() != LCD_FLUSH_IDLE) CheckFail(frame, "still busy after the last transfer");
+    if (flushCallbacks != callbacks + 1) CheckFail(frame, "not exactly one flush callback");
+
+    LCD_Emu_EndFrame();
+    LCD_Emu_GetFrameStats(&stats);
+    if (stats.timingFaults) CheckFail(frame, "access shorter than t_CYC/t_PW");
+
+    CheckTransfers(frame);
+    CheckScreen(frame);
+    transfers += LCD_Host_DMA_LogCount;
+    if (LCD_Host_DMA_LogCount == LCD_DMA_MAX_RUNS) overflows++;
+  }
+
+  printf("dma_check: %u frames, %lu transfers, %lu frames at the run limit, %lu direct draws mid-flush: %s\n",
+         CHECK_FRAMES, transfers, overflows, directDraws, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
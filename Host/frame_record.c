@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file    frame_record.c
+ * @brief   Record the frame buffer of a headless game for the benchmarks
+ ******************************************************************************
+ *
+ * Plays one game through GameCore_Step() with the board's drawing code
+ * (the same GameIO callbacks main.c uses, minus LEDs and profiler) and a
+ * simple bot on the button that jumps when a cactus comes close, and
+ * misses now and then. After every tick the frame buffer and its dirty
+ * column ranges are recorded (frames.h); the game over screen is the last
+ * frame. The committed frames.bin was made with
+ *
+ *   ./frame_record frames.bin 1 600
+ *
+ * Arguments: output file, game seed (default 1), most ticks (default 600).
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "frames.h"
+#include "game_core.h"
+
+static const GameIO recordIO = {
+  clearSprite,
+  moveDino,
+  moveCactus,
+  0,
+  0
+};
+
+/*******************************************************************************
+* Function Name  : BotInput
+* Description    : Press when a cactus is a few ticks away, except for every
+*                  fifth cactus, so lives are lost and the game ends
+*******************************************************************************/
+static unsigned char BotInput(const GameCore *core)
+{
+  const DinoGameState *game = &core->state;
+  int i;
+
+  for (i = 0; i < MAX_OBSTACLES; i++) {
+    const Obstacle *obs = &core->obstacles[i];
+    int lead = 12 + Q8_INT(game->worldSpeed * 6);   // Columns covered in ~6 ticks
+
+    if (obs->active && obs->y > game->dinoY && obs->y < game->dinoY + 16 + lead &&
+        (game->score + i) % 5 != 4) {
+      return GAME_INPUT_BUTTON | GAME_INPUT_PRESS;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  GameCore core;
+  Recording rec = {NULL, 0};
+  unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+  unsigned long ticks = argc > 3 ? strtoul(argv[3], NULL, 0) : 600;
+  unsigned long t;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <out.bin> [seed] [ticks]\n", argv[0]);
+    return 2;
+  }
+
+  LCD_Emu_Reset();
+  LCD_Init();
+  LCD_Clear();
+  LCD_InitFrameBuffer();
+  cacheSprites();
+
+  // Scenery, as main.c draws it when a game starts
+  GameCore_Init(&core, (uint32_t)seed, 3);
+  drawGroundLine(0);
+  drawStar(0, 20);
+  drawMoon(0, 90);
+  LCD_Background_Capture();
+
+  for (t = 0; t < ticks; t++) {
+    if (GameCore_Step(&core, BotInput(&core), &recordIO) == GAME_STEP_OVER) {
+      drawDinoDead(&core.state);
+      drawEndScreen();
+      t = ticks;
+    }
+    if (Frames_Append(&rec) != 0) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    LCD_SwapBuffers();
+  }
+
+  if (Frames_Save(&rec, argv[1]) != 0) {
+    fprintf(stderr, "cannot write %s\n", argv[1]);
+    return 1;
+  }
+  printf("%u frames, score %u, lives %u\n", rec.count, core.state.score, core.state.lives);
+  Frames_Free(&rec);
+  return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ ******************************************************************************
+ * @file    frames.c
+ * @brief   Recorded gameplay frames for the host benchmarks
+ ******************************************************************************
+ *
+ * See frames.h.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frames.h"
+
+/*******************************************************************************
+* Function Name  : Frames_ReadU16 / Frames_WriteU16
+* Description    : Little-endian 16-bit fields
+*******************************************************************************/
+static int Frames_ReadU16(FILE *f, unsigned int *value)
+{
+  int lo = fgetc(f), hi = fgetc(f);
+  if (lo == EOF || hi == EOF) return -1;
+  *value = (unsigned int)lo | ((unsigned int)hi << 8);
+  return 0;
+}
+
+static void Frames_WriteU16(FILE *f, unsigned int value)
+{
+  fputc(value & 0xFF, f);
+  fputc((value >> 8) & 0xFF, f);
+}
+
+/*******************************************************************************
+* Function Name  : Frames_Load
+* Description    : Read a recording written by Frames_Save()
+* Input          : path -- file name
+* Output         : rec -- frames, free with Frames_Free()
+* Return         : 0 -- ok, -1 -- cannot read or not a recording
+*******************************************************************************/
+int Frames_Load(Recording *rec, const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  char magic[4];
+  unsigned int version, count, i, j, n, offset;
+  unsigned char prev[LCD_BUFFER_SIZE];
+
+  rec->frame = NULL;
+  rec->count = 0;
+  if (f == NULL) return -1;
+  if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "LCDF", 4) != 0 ||
+      Frames_ReadU16(f, &version) || version != FRAMES_VERSION ||
+      Frames_ReadU16(f, &count) || count == 0) {
+    fclose(f);
+    return -1;
+  }
+
+  rec->frame = calloc(count, sizeof(RecordedFrame));
+  if (rec->frame == NULL) {
+    fclose(f);
+    return -1;
+  }
+  memset(prev, 0, sizeof(prev));
+  for (i = 0; i < count; i++) {
+    RecordedFrame *fr = &rec->frame[i];
+
+    if (fread(fr->dirtyColMin, 1, LCD_PAGES, f) != LCD_PAGES ||
+        fread(fr->dirtyColMax, 1, LCD_PAGES, f) != LCD_PAGES ||
+        Frames_ReadU16(f, &n)) break;
+    memcpy(fr->buffer, prev, LCD_BUFFER_SIZE);
+    for (j = 0; j < n; j++) {
+      int value;
+      if (Frames_ReadU16(f, &offset) || offset >= LCD_BUFFER_SIZE || (value = fgetc(f)) == EOF) break;
+      fr->buffer[offset] = (unsigned char)value;
+    }
+    if (j != n) break;                  // Short change list
+    memcpy(prev, fr->buffer, LCD_BUFFER_SIZE);
+  }
+  fclose(f);
+  if (i != count) {
+    Frames_Free(rec);
+    return -1;
+  }
+  rec->count = count;
+  return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Frames_Save
+* Description    : Write a recording, each frame as its changes
+* Input          : rec -- frames, path -- file name
+* Output         : None
+* Return         : 0 -- ok, -1 -- cannot write
+*******************************************************************************/
+int Frames_Save(const Recording *rec, const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  unsigned char prev[LCD_BUFFER_SIZE];
+  unsigned int i, offset, n;
+
+  if (f == NULL) return -1;
+  fwrite("LCDF", 1, 4, f);
+  Frames_WriteU16(f, FRAMES_VERSION);
+  Frames_WriteU16(f, rec->count);
+  memset(prev, 0, sizeof(prev));
+  for (i = 0; i < rec->count; i++) {
+    const RecordedFrame *fr = &rec->frame[i];
+
+    fwrite(fr->dirtyColMin, 1, LCD_PAGES, f);
+    fwrite(fr->dirtyColMax, 1, LCD_PAGES, f);
+    for (n = 0, offset = 0; offset < LCD_BUFFER_SIZE; offset++) {
+      if (fr->buffer[offset] != prev[offset]) n++;
+    }
+    Frames_WriteU16(f, n);
+    for (offset = 0; offset < LCD_BUFFER_SIZE; offset++) {
+      if (fr->buffer[offset] != prev[offset]) {
+        Frames_WriteU16(f, offset);
+        fputc(fr->buffer[offset], f);
+      }
+    }
+    memcpy(prev, fr->buffer, LCD_BUFFER_SIZE);
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+/*******************************************************************************
+* Function Name  : Frames_Append
+* Description    : Add frameBuffer and the current dirty ranges as a frame
+* Input          : rec -- recording to grow
+* Output         : None
+* Return         : 0 -- ok, -1 -- out of memory
+*******************************************************************************/
+int Frames_Append(Recording *rec)
+{
+  RecordedFrame *grown = realloc(rec->frame, (rec->count + 1) * sizeof(RecordedFrame));
+  RecordedFrame *fr;
+
+  if (grown == NULL) return -1;
+  rec->frame = grown;
+  fr = &rec->frame[rec->count++];
+  memcpy(fr->buffer, frameBuffer, LCD_BUFFER_SIZE);
+  memcpy(fr->dirtyColMin, dirtyColMin, LCD_PAGES);
+  memcpy(fr->dirtyColMax, dirtyColMax, LCD_PAGES);
+  return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Frames_Apply
+* Description    : Put a recorded frame into frameBuffer with its dirty pages
+*                  and column ranges, as if it had just been drawn
+* Input          : frame -- recorded frame
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Frames_Apply(const RecordedFrame *frame)
+{
+  unsigned char page;
+
+  memcpy(frameBuffer, frame->buffer, LCD_BUFFER_SIZE);
+  for (page = 0; page < LCD_PAGES; page++) {
+    dirtyColMin[page] = frame->dirtyColMin[page];
+    dirtyColMax[page] = frame->dirtyColMax[page];
+    dirtyPages[page] = frame->dirtyColMin[page] < LCD_WIDTH;
+  }
+}
+
+void Frames_Free(Recording *rec)
+{
+  free(rec->frame);
+  rec->frame = NULL;
+  rec->count = 0;
+}
@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * @file    frames.h
+ * @brief   Recorded gameplay frames for the host benchmarks
+ ******************************************************************************
+ *
+ * A recording is the frame buffer after every simulation tick of a real
+ * game (frame_record.c), together with the dirty column range the drawing
+ * code left on each page, i.e. exactly what LCD_SwapBuffers() is given on
+ * the board. Consecutive records are the frame pairs the diff and flush
+ * benchmarks replay.
+ *
+ * FILE FORMAT (little-endian):
+ * ----------------------------
+ *   "LCDF" <version, u16> <frame count, u16>
+ *   per frame: <dirtyColMin, 8 bytes> <dirtyColMax, 8 bytes>
+ *              <changes, u16> changes x (<offset, u16> <byte>)
+ *
+ * Changes are against the previous frame (the first against a blank
+ * buffer), so a few hundred ticks of play fit in tens of kilobytes.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __FRAMES_H
+#define __FRAMES_H
+
+#include "lcd.h"
+
+#define FRAMES_VERSION        1
+
+typedef struct {
+  unsigned char buffer[LCD_BUFFER_SIZE];
+  unsigned char dirtyColMin[LCD_PAGES];   // LCD_WIDTH -- page not written
+  unsigned char dirtyColMax[LCD_PAGES];
+} RecordedFrame;
+
+typedef struct {
+  RecordedFrame *frame;
+  unsigned int count;
+} Recording;
+
+int Frames_Load(Recording *rec, const char *path);           // 0 -- ok
+int Frames_Save(const Recording *rec, const char *path);     // 0 -- ok
+int Frames_Append(Recording *rec);      // Current frameBuffer and dirty ranges; 0 -- ok
+void Frames_Apply(const RecordedFrame *frame);  // Into frameBuffer, dirty ranges marked
+void Frames_Free(Recording *rec);
+
+#endif /* __FRAMES_H */
@@ -0,0 +1,277 @@
+/**
+ ******************************************************************************
+ * @file    move_check.c
+ * @brief   Host check of LCD_Buffer_MoveSprite() against clear-then-draw
+ ******************************************************************************
+ *
+ * LCD_Buffer_MoveSprite() must leave the frame buffer exactly as erasing
+ * the old footprint (LCD_Buffer_RestoreRect) and then drawing the sprite
+ * (LCD_Buffer_DrawSprite) would. Two parts:
+ * - games: CHECK_GAMES seeded games, each played twice in lockstep with
+ *   the same button presses - once with the board's GameIO (moveDino,
+ *   moveCactus) and once with clear-then-draw callbacks - over the same
+ *   scenery. The two frame buffers must be equal after every tick.
+ * - moves: random single moves on random buffer and background contents,
+ *   from and to anywhere from off the left edge to off the right and down
+ *   to the last row, 1 and 2 glyphs wide. Besides the frame buffer, every
+ *   byte that changed must lie inside its page's dirty column range. The
+ *   moves must include footprints clipped at the edges, a union that
+ *   starts above the new position (page < toPage, where the glyph page
+ *   index wraps and must not be used) and footprints that do not overlap
+ *   (the restore + draw fallback).
+ * The Makefile builds this with AddressSanitizer and UBSan: a glyph column
+ * read at the wrapped page index often ORs in zeros and leaves the frame
+ * buffer unchanged, so only the sanitizer reports it.
+ *
+ *   make -C Host check      (or ./move_check after make -C Host)
+ *
+ * Exit status 0 -- all checks passed, 1 -- a failure was printed.
+ *
+ ******************************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "game_core.h"
+
+#define CHECK_GAMES           40
+#define CHECK_LIVES           3
+#define CHECK_MAX_TICKS       20000   // Per game, in case the bot survives
+#define CHECK_PRESS_ODDS      12      // One tick in this many presses the button
+#define CHECK_MOVES           200000
+
+static unsigned char moveBuffer[LCD_BUFFER_SIZE];     // Frame buffer of the MoveSprite game
+static unsigned char refBuffer[LCD_BUFFER_SIZE];      // Frame buffer of the clear-then-draw game
+static unsigned char before[LCD_BUFFER_SIZE];
+static unsigned long checkRandom = 1;
+static unsigned int failures = 0;
+
+/*******************************************************************************
+* Function Name  : RefMoveDino / RefMoveCactus
+* Description    : GameIO moves as clear-then-draw, as before MoveSprite
+*******************************************************************************/
+static void RefMoveDino(DinoGameState *state, unsigned char fromRow)
+{
+  clearSprite(fromRow, state->dinoY, 2);
+  drawDino(state);
+}
+
+static void RefMoveCactus(unsigned char x, signed short fromY, signed short toY, unsigned char type)
+{
+  clearSprite(x * 8, fromY, type == 0 ? 2 : 1);
+  drawCactus(x, toY, type);
+}
+
+static const GameIO moveIO = {clearSprite, moveDino, moveCactus, 0, 0};
+static const GameIO refIO = {clearSprite, RefMoveDino, RefMoveCactus, 0, 0};
+
+/*******************************************************************************
+* Function Name  : CheckRand
+* Description    : Small LCG, so the moves are the same on every run
+*******************************************************************************/
+static unsigned int CheckRand(unsigned int range)
+{
+  checkRandom = checkRandom * 1103515245UL + 12345UL;
+  return (unsigned int)((checkRandom >> 16) & 0x7FFF) % range;
+}
+
+/*******************************************************************************
+* Function Name  : CheckFail
+* Description    : Report one failed check (the first few only)
+*******************************************************************************/
+static void CheckFail(const char *what, unsigned long n, unsigned long tick)
+{
+  if (failures++ < 10) {
+    printf("%s %lu, tick %lu: differs from clear-then-draw\n", what, n, tick);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : StepWith
+* Description    : One tick of a game on its own frame buffer
+*******************************************************************************/
+static unsigned char StepWith(GameCore *core, unsigned char *buffer, unsigned char input, const GameIO *io)
+{
+  unsigned char result;
+
+  memcpy(frameBuffer, buffer, LCD_BUFFER_SIZE);
+  result = GameCore_Step(core, input, io);
+  memcpy(buffer, frameBuffer, LCD_BUFFER_SIZE);
+  return result;
+}
+
+/*******************************************************************************
+* Function Name  : CheckGames
+* Description    : The games part (see the file header)
+* Return         : Ticks compared
+*******************************************************************************/
+static unsigned long CheckGames(void)
+{
+  GameCore moveCore, refCore;
+  PrngStream bot;
+  unsigned long game, tick, ticks = 0;
+  unsigned char input, moveResult, refResult;
+
+  for (game = 1; game <= CHECK_GAMES; game++) {
+    // Scenery, as main.c draws it when a game starts
+    LCD_InitFrameBuffer();
+    drawGroundLine(0);
+    drawStar(0, 20);
+    drawMoon(0, 90);
+    LCD_Background_Capture();
+    memcpy(moveBuffer, frameBuffer, LCD_BUFFER_SIZE);
+    memcpy(refBuffer, frameBuffer, LCD_BUFFER_SIZE);
+
+    GameCore_Init(&moveCore, (uint32_t)game, CHECK_LIVES);
+    GameCore_Init(&refCore, (uint32_t)game, CHECK_LIVES);
+    Prng_Seed(&bot, (uint32_t)game, 2);
+    for (tick = 0; tick < CHECK_MAX_TICKS; tick++) {
+      input = Prng_Range(&bot, CHECK_PRESS_ODDS) == 0 ? GAME_INPUT_BUTTON | GAME_INPUT_PRESS : 0;
+      moveResult = StepWith(&moveCore, moveBuffer, input, &moveIO);
+      refResult = StepWith(&refCore, refBuffer, input, &refIO);
+      ticks++;
+      if (memcmp(moveBuffer, refBuffer, LCD_BUFFER_SIZE) != 0 || moveResult != refResult) {
+        CheckFail("game", game, tick);
+        break;
+      }
+      if (moveResult == GAME_STEP_OVER) break;
+    }
+  }
+  return ticks;
+}
+
+/*******************************************************************************
+* Function Name  : RandomPos
+* Description    : A position anywhere from 20 columns off the left edge to
+*                  20 off the right, any row; edges and the last rows are
+*                  picked more often than a flat spread would
+*******************************************************************************/
+static void RandomPos(LCD_SpritePos *pos)
+{
+  switch (CheckRand(4)) {
+    case 0:  pos->col = (signed short)CheckRand(24) - 20; break;          // Left edge
+    case 1:  pos->col = (signed short)(LCD_WIDTH - 12 + CheckRand(24)); break;  // Right edge
+    default: pos->col = (signed short)CheckRand(LCD_WIDTH + 40) - 20; break;
+  }
+  pos->row = (unsigned char)(CheckRand(3) == 0 ? LCD_HEIGHT - 16 + CheckRand(16) : CheckRand(LCD_HEIGHT));
+}
+
+/*******************************************************************************
+* Function Name  : NearPos
+* Description    : A position a few pixels from another, so the footprints
+*                  usually overlap, as in a game
+*******************************************************************************/
+static void NearPos(const LCD_SpritePos *from, LCD_SpritePos *to)
+{
+  int row = from->row + (int)CheckRand(25) - 12;
+
+  if (row < 0) row = 0;
+  if (row >= LCD_HEIGHT) row = LCD_HEIGHT - 1;
+  to->row = (unsigned char)row;
+  to->col = from->col + (signed short)CheckRand(21) - 10;
+}
+
+/*******************************************************************************
+* Function Name  : CheckDirty
+* Description    : Every byte that differs from before lies inside its page's
+*                  dirty column range
+*******************************************************************************/
+static int CheckDirty(void)
+{
+  unsigned int page, col;
+
+  for (page = 0; page < LCD_PAGES; page++) {
+    for (col = 0; col < LCD_WIDTH; col++) {
+      if (frameBuffer[page * LCD_WIDTH + col] == before[page * LCD_WIDTH + col]) continue;
+      if (!dirtyPages[page] || col < dirtyColMin[page] || col > dirtyColMax[page]) return 0;
+    }
+  }
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : CheckMoves
+* Description    : The moves part (see the file header)
+* Output         : clipped, wrapped, fallback -- moves of each kind
+*******************************************************************************/
+static void CheckMoves(unsigned long *clipped, unsigned long *wrapped, unsigned long *fallback)
+{
+  static const unsigned char offsets[] = {120, 122, 125, 127, 129, 131, 137};
+  LCD_SpritePos from, to;
+  LCD_Sprite sprite;
+  unsigned long n;
+  unsigned int i;
+  signed short span, fromRight, toRight;
+
+  for (n = 0; n < CHECK_MOVES; n++) {
+    // New scenery and screen now and then, a few bits set in each
+    if (n % 64 == 0) {
+      for (i = 0; i < LCD_BUFFER_SIZE; i++) {
+        frameBuffer[i] = (unsigned char)(CheckRand(256) & CheckRand(256));
+      }
+      LCD_Background_Capture();
+      for (i = 0; i < LCD_BUFFER_SIZE; i++) {
+        frameBuffer[i] ^= (unsigned char)(CheckRand(256) & CheckRand(256) & CheckRand(256));
+      }
+    }
+
+    sprite.offset = offsets[CheckRand(sizeof(offsets))];
+    sprite.width = (unsigned char)(1 + CheckRand(LCD_SPRITE_MAX_WIDTH));
+    RandomPos(&from);
+    if (CheckRand(4) == 0) RandomPos(&to); else NearPos(&from, &to);
+
+    span = (signed short)sprite.width * 8;
+    fromRight = from.col + span - 1;
+    toRight = to.col + span - 1;
+    if (from.col > toRight || to.col > fromRight || from.row > to.row + 15 || to.row > from.row + 15) {
+      (*fallback)++;
+    } else {
+      if (from.row < to.row && (from.row >> 3) < (to.row >> 3)) (*wrapped)++;
+      if (from.col < 0 || to.col < 0 || fromRight >= LCD_WIDTH || toRight >= LCD_WIDTH ||
+          from.row > LCD_HEIGHT - 16 || to.row > LCD_HEIGHT - 16) {
+        (*clipped)++;
+      }
+    }
+
+    // Reference first, from the same starting buffer
+    memcpy(before, frameBuffer, LCD_BUFFER_SIZE);
+    LCD_Buffer_RestoreRect(from.col, from.row, fromRight, from.row + 15);
+    LCD_Buffer_DrawSprite(to.row, to.col, sprite.offset, sprite.width);
+    memcpy(refBuffer, frameBuffer, LCD_BUFFER_SIZE);
+
+    memcpy(frameBuffer, before, LCD_BUFFER_SIZE);
+    for (i = 0; i < LCD_PAGES; i++) {
+      dirtyPages[i] = 0;
+      dirtyColMin[i] = LCD_WIDTH;
+      dirtyColMax[i] = 0;
+    }
+    LCD_Buffer_MoveSprite(&from, &to, &sprite);
+    if (memcmp(frameBuffer, refBuffer, LCD_BUFFER_SIZE) != 0) {
+      CheckFail("move", n, 0);
+    } else if (!CheckDirty()) {
+      if (failures++ < 10) printf("move %lu: changed byte outside the dirty range\n", n);
+    }
+  }
+}
+
+int main(void)
+{
+  unsigned long ticks, clipped = 0, wrapped = 0, fallback = 0;
+
+  LCD_Emu_Reset();
+  LCD_Init();
+  LCD_Clear();
+  LCD_InitFrameBuffer();
+  cacheSprites();
+
+  ticks = CheckGames();
+  CheckMoves(&clipped, &wrapped, &fallback);
+  if (!clipped || !wrapped || !fallback) {
+    failures++;
+    printf("move kinds not all covered\n");
+  }
+
+  printf("move_check: %d games, %lu ticks; %d moves: %lu clipped, %lu from a page above, %lu fallback: %s\n",
+         CHECK_GAMES, ticks, CHECK_MOVES, clipped, wrapped, fallback, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+/**
+ ******************************************************************************
+ * @file    replay_run.c
+ * @brief   Host playback of replays captured from the board, and a self-test
+ ******************************************************************************
+ *
+ * Default: reads a USART1 capture (the TAMPER dump, or any text holding
+ * Replay_Dump() output) from stdin, parses every replay in it with
+ * Replay_ParseChar() and plays each one headless through Replay_Run(),
+ * the same GameCore_Step() the board ran. Each replay prints ok or
+ * MISMATCH against its END line, and the playback speed.
+ *
+ *   ./replay_run < capture.txt
+ *
+ * -selftest records games with random input for seeds 1..n, dumps each
+ * to text, parses it back and replays it, which must give the recorded
+ * tick count and score. Then every character of the run list is dropped
+ * in turn: the parser must reject the text, unless the character was a CR
+ * or LF and the text still reads back as the same recording.
+ *
+ *   ./replay_run -selftest [seeds=2000]
+ *
+ * -dump writes the text of one such recorded game, e.g. to try the stdin
+ * path without a board:
+ *
+ *   ./replay_run -dump 7 | ./replay_run
+ *
+ * Exit status 0 -- everything matched, 1 -- a mismatch or parse error.
+ *
+ ******************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "replay.h"
+
+#define RUN_PRESS_ODDS        20      // One tick in this many starts a press
+#define RUN_HOLD_MAX          8       // Ticks a press is held, at most
+#define RUN_MAX_TICKS         100000  // Stop recording a game that long
+#define RUN_MIN_NS            50e6    // Repeat a playback for at least this long
+
+static const GameIO headlessIO = {0, 0, 0, 0, 0};
+
+static char dumpText[REPLAY_MAX_RUNS * 5 + 64];
+static unsigned int dumpLength;
+
+/*******************************************************************************
+* Function Name  : NowNs
+* Description    : Monotonic clock in nanoseconds
+*******************************************************************************/
+static double NowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*******************************************************************************
+* Function Name  : WriteDump
+* Description    : Replay_Dump() writer that collects the text in dumpText
+*******************************************************************************/
+static void WriteDump(const char *text, unsigned int length)
+{
+  memcpy(dumpText + dumpLength, text, length);
+  dumpLength += length;
+}
+
+/*******************************************************************************
+* Function Name  : RecordGame
+* Description    : Play one game with random presses and record it, as main.c
+*                  does on the board
+* Input          : seed -- game seed (also seeds the input)
+* Output         : replay -- the recording
+*******************************************************************************/
+static void RecordGame(Replay *replay, uint32_t seed)
+{
+  GameCore core;
+  PrngStream bot;
+  unsigned char lives = 1 + seed % 4;
+  unsigned char input, held = 0;
+
+  GameCore_Init(&core, seed, lives);
+  Replay_Begin(replay, seed, lives);
+  Prng_Seed(&bot, seed, 3);
+  do {
+    input = 0;
+    if (held) {
+      held--;
+      input = GAME_INPUT_BUTTON;
+    } else if (Prng_Range(&bot, RUN_PRESS_ODDS) == 0) {
+      held = (unsigned char)Prng_Range(&bot, RUN_HOLD_MAX);
+      input = GAME_INPUT_BUTTON | GAME_INPUT_PRESS;
+    }
+    GameCore_Step(&core, input, &headlessIO);
+    Replay_Record(replay, input, core.state.score);
+  } while (!core.over && core.tickCount < RUN_MAX_TICKS);
+}
+
+/*******************************************************************************
+* Function Name  : ParseText
+* Description    : Feed text to a fresh parser, then end the input
+* Return         : Replay_ParseEnd() result
+*******************************************************************************/
+static unsigned char ParseText(Replay *replay, const char *text, unsigned int length)
+{
+  ReplayParser parser;
+  unsigned int i;
+
+  Replay_ParserInit(&parser, replay);
+  for (i = 0; i < length; i++) {
+    Replay_ParseChar(&parser, text[i]);
+  }
+  return Replay_ParseEnd(&parser);
+}
+
+/*******************************************************************************
+* Function Name  : PlayTimed
+* Description    : Replay_Run() repeated for at least RUN_MIN_NS
+* Output         : ticksPerSecond -- playback speed
+* Return         : 1 -- every run ended where the recording did
+*******************************************************************************/
+static unsigned char PlayTimed(const Replay *replay, double *ticksPerSecond)
+{
+  GameCore core;
+  unsigned char ok = 1;
+  unsigned long reps = 0;
+  double t0 = NowNs(), ns;
+
+  do {
+    ok &= Replay_Run(replay, &core, &headlessIO);
+    reps++;
+    ns = NowNs() - t0;
+  } while (ns < RUN_MIN_NS);
+  *ticksPerSecond = (double)replay->ticks * reps / ns * 1e9;
+  return ok;
+}
+
+/*******************************************************************************
+* Function Name  : SameReplay
+* Description    : Two recordings hold the same game
+*******************************************************************************/
+static int SameReplay(const Replay *a, const Replay *b)
+{
+  return a->seed == b->seed && a->lives == b->lives && a->ticks == b->ticks &&
+         a->score == b->score && a->runCount == b->runCount &&
+         memcmp(a->runs, b->runs, a->runCount * sizeof(a->runs[0])) == 0;
+}
+
+/*******************************************************************************
+* Function Name  : SelfTest
+* Description    : Record, dump, parse and replay seeds 1..seeds. Then drop
+*                  each character of the run list in turn: the parser must
+*                  reject the text, or (a lost CR or LF, the tokens are still
+*                  separated) read back the same recording.
+*******************************************************************************/
+static int SelfTest(unsigned long seeds)
+{
+  static Replay recorded, parsed;
+  static char dropped[sizeof(dumpText)];
+  GameCore core;
+  unsigned long seed, failures = 0, ticks = 0, rejected = 0, harmless = 0;
+  unsigned int runsStart, runsEnd, drop;
+  unsigned char result;
+  double ns = 0, t0;
+
+  for (seed = 1; seed <= seeds; seed++) {
+    RecordGame(&recorded, (uint32_t)seed);
+    dumpLength = 0;
+    Replay_Dump(&recorded, WriteDump);
+
+    if (ParseText(&parsed, dumpText, dumpLength) != REPLAY_PARSE_DONE || !SameReplay(&parsed, &recorded)) {
+      printf("seed %lu: dump did not parse back to the recording\n", seed);
+      failures++;
+      continue;
+    }
+
+    t0 = NowNs();
+    if (!Replay_Run(&parsed, &core, &headlessIO)) {
+      printf("seed %lu: MISMATCH, recorded %lu ticks score %lu, played %u ticks score %lu\n",
+             seed, (unsigned long)recorded.ticks, (unsigned long)recorded.score,
+             core.tickCount, (unsigned long)core.state.score);
+      failures++;
+    }
+    ns += NowNs() - t0;
+    ticks += parsed.ticks;
+
+    // The run list: from after the header line up to END
+    runsStart = (unsigned int)(strchr(dumpText, '\n') - dumpText) + 1;
+    runsEnd = (unsigned int)(strstr(dumpText, "END") - dumpText);
+    for (drop = runsStart; drop < runsEnd; drop++) {
+      memcpy(dropped, dumpText, drop);
+      memcpy(dropped + drop, dumpText + drop + 1, dumpLength - drop - 1);
+      result = ParseText(&parsed, dropped, dumpLength - 1);
+      if (result == REPLAY_PARSE_ERROR) {
+        rejected++;
+      } else if (result == REPLAY_PARSE_DONE && SameReplay(&parsed, &recorded) &&
+                 (dumpText[drop] == '\r' || dumpText[drop] == '\n')) {
+        harmless++;
+      } else {
+        printf("seed %lu: dropped character at %u not rejected\n", seed, drop);
+        failures++;
+      }
+    }
+  }
+
+  printf("replay_run: %lu seeds recorded, dumped, parsed and replayed at %.1fM ticks/s; "
+         "dropped characters: %lu rejected, %lu line ends without effect: %s\n",
+         seeds, ticks / ns * 1e3, rejected, harmless, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+/*******************************************************************************
+* Function Name  : RunCapture
+* Description    : Parse every replay in a capture on stdin and play it
+*******************************************************************************/
+static int RunCapture(void)
+{
+  static Replay replay;
+  ReplayParser parser;
+  unsigned int found = 0, failures = 0;
+  unsigned char result;
+  double ticksPerSecond;
+  int c;
+
+  Replay_ParserInit(&parser, &replay);
+  do {
+    c = getchar();
+    result = Replay_ParseChar(&parser, c == EOF ? '\n' : (char)c);  // EOF ends the last token
+    if (c == EOF && result == REPLAY_PARSE_MORE) result = Replay_ParseEnd(&parser);
+
+    if (result == REPLAY_PARSE_DONE) {
+      found++;
+      if (PlayTimed(&replay, &ticksPerSecond)) {
+        printf("replay %u seed %08lX lives %u: %lu ticks, score %lu: ok (%.1fM ticks/s)\n",
+               found, (unsigned long)replay.seed, replay.lives,
+               (unsigned long)replay.ticks, (unsigned long)replay.score, ticksPerSecond / 1e6);
+      } else {
+        printf("replay %u seed %08lX lives %u: %lu ticks, score %lu: MISMATCH\n",
+               found, (unsigned long)replay.seed, replay.lives,
+               (unsigned long)replay.ticks, (unsigned long)replay.score);
+        failures++;
+      }
+      Replay_ParserInit(&parser, &replay);
+    } else if (result == REPLAY_PARSE_ERROR) {
+      printf("replay %u: parse error (version %u expected)\n", found + 1, REPLAY_VERSION);
+      failures++;
+      Replay_ParserInit(&parser, &replay);
+    }
+  } while (c != EOF);
+
+  if (found == 0 && failures == 0) {
+    printf("no replay in the input\n");
+    return 1;
+  }
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  static Replay replay;
+
+  if (argc > 1 && strcmp(argv[1], "-selftest") == 0) {
+    return SelfTest(argc > 2 ? strtoul(argv[2], NULL, 0) : 2000);
+  }
+  if (argc > 2 && strcmp(argv[1], "-dump") == 0) {
+    RecordGame(&replay, (uint32_t)strtoul(argv[2], NULL, 0));
+    dumpLength = 0;
+    Replay_Dump(&replay, WriteDump);
+    fwrite(dumpText, 1, dumpLength, stdout);
+    return 0;
+  }
+  if (argc > 1) {
+    fprintf(stderr, "usage: %s [-selftest [seeds] | -dump seed] < capture\n", argv[0]);
+    return 1;
+  }
+  return RunCapture();
+}
@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * @file    sprite_bench.c
+ * @brief   Sub-page glyph draws: cached vs shifted vs LCD_Buffer_DrawChar()
+ ******************************************************************************
+ *
+ * Times one 8x16 glyph into the frame buffer three ways, over the same
+ * sequence of pseudo-random positions:
+ * - LCD_Buffer_DrawChar(): the page-aligned copy the game used before the
+ *   sub-page blitter, at the position's page
+ * - LCD_Buffer_DrawGlyph() with the glyph in the pre-shifted cache
+ *   (LCD_GlyphCache_Add), at any pixel row
+ * - LCD_Buffer_DrawGlyph() with a glyph that is not cached, so every draw
+ *   shifts it first
+ * The frame buffer is cleared between passes, outside the timing. A game
+ * frame draws two glyphs per 16x16 sprite (dino and each cactus).
+ *
+ * As a check, a glyph drawn while uncached and again once cached must give
+ * the same frame buffer at every position, or the benchmark fails.
+ *
+ *   ./sprite_bench [repetitions]
+ *
+ * Exit status 0 -- ok, 1 -- cached and shifted draws differ.
+ *
+ ******************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lcd.h"
+
+#define BENCH_DRAWS           4096
+#define BENCH_CACHED          125     // SPRITE_DINO_STAND, left half
+#define BENCH_UNCACHED        137     // SPRITE_BIRD_FLY, left half
+
+typedef struct {
+  unsigned char row;
+  signed short col;
+} BenchPos;
+
+static BenchPos benchPos[BENCH_DRAWS];
+
+/*******************************************************************************
+* Function Name  : NowNs
+* Description    : Monotonic clock in nanoseconds
+*******************************************************************************/
+static double NowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*******************************************************************************
+* Function Name  : MakePositions
+* Description    : Rows 0-48 and columns 0-120, so every draw is whole and
+*                  LCD_Buffer_DrawChar() has a page pair at every row
+*******************************************************************************/
+static void MakePositions(void)
+{
+  unsigned long x = 1;
+  unsigned int i;
+
+  for (i = 0; i < BENCH_DRAWS; i++) {
+    x = x * 1103515245UL + 12345UL;
+    benchPos[i].row = (unsigned char)(((x >> 16) & 0x7FFF) % 49);
+    x = x * 1103515245UL + 12345UL;
+    benchPos[i].col = (signed short)(((x >> 16) & 0x7FFF) % 121);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : TimeDrawChar / TimeDrawGlyph
+* Description    : One pass over the positions
+* Return         : Nanoseconds for the pass
+*******************************************************************************/
+static double TimeDrawChar(unsigned char offset)
+{
+  unsigned int i;
+  double t0;
+
+  LCD_InitFrameBuffer();
+  t0 = NowNs();
+  for (i = 0; i < BENCH_DRAWS; i++) {
+    LCD_Buffer_DrawChar(benchPos[i].row >> 3, (unsigned char)benchPos[i].col, offset);
+  }
+  return NowNs() - t0;
+}
+
+static double TimeDrawGlyph(unsigned char offset)
+{
+  unsigned int i;
+  double t0;
+
+  LCD_InitFrameBuffer();
+  t0 = NowNs();
+  for (i = 0; i < BENCH_DRAWS; i++) {
+    LCD_Buffer_DrawGlyph(benchPos[i].row, benchPos[i].col, offset);
+  }
+  return NowNs() - t0;
+}
+
+/*******************************************************************************
+* Function Name  : CheckCachedMatches
+* Description    : Draw BENCH_UNCACHED at every position, cache it, draw it
+*                  again; both frame buffers must be equal
+* Return         : 0 -- equal (or no cache to compare), 1 -- they differ
+*******************************************************************************/
+static int CheckCachedMatches(void)
+{
+  static unsigned char shifted[LCD_BUFFER_SIZE];
+  unsigned int i;
+
+  LCD_InitFrameBuffer();
+  for (i = 0; i < BENCH_DRAWS; i++) {
+    LCD_Buffer_DrawGlyph(benchPos[i].row, benchPos[i].col, BENCH_UNCACHED);
+  }
+  memcpy(shifted, frameBuffer, LCD_BUFFER_SIZE);
+
+  if (!LCD_GlyphCache_Add(BENCH_UNCACHED)) return 0;
+  LCD_InitFrameBuffer();
+  for (i = 0; i < BENCH_DRAWS; i++) {
+    LCD_Buffer_DrawGlyph(benchPos[i].row, benchPos[i].col, BENCH_UNCACHED);
+  }
+  return memcmp(shifted, frameBuffer, LCD_BUFFER_SIZE) != 0;
+}
+
+int main(int argc, char **argv)
+{
+  int reps = argc > 1 ? atoi(argv[1]) : 200;
+  double charNs = 0, cachedNs = 0, shiftedNs = 0;
+  int r;
+
+  if (reps < 1) reps = 1;
+  MakePositions();
+  LCD_Emu_Reset();
+  LCD_GlyphCache_Add(BENCH_CACHED);
+
+  // Interleaved, so drift in the host clock hits all three alike
+  for (r = 0; r < reps; r++) {
+    charNs += TimeDrawChar(BENCH_CACHED);
+    cachedNs += TimeDrawGlyph(BENCH_CACHED);
+    shiftedNs += TimeDrawGlyph(BENCH_UNCACHED);
+  }
+
+  printf("sprite_bench: %u draws x %d repetitions, per 8x16 glyph:\n", BENCH_DRAWS, reps);
+  printf("  LCD_Buffer_DrawChar, page-aligned : %6.1f ns\n", charNs / ((double)BENCH_DRAWS * reps));
+  printf("  DrawGlyph, cached, any row        : %6.1f ns\n", cachedNs / ((double)BENCH_DRAWS * reps));
+  printf("  DrawGlyph, uncached, any row      : %6.1f ns\n", shiftedNs / ((double)BENCH_DRAWS * reps));
+
+  if (CheckCachedMatches()) {
+    printf("  cached and shifted draws differ: FAILED\n");
+    return 1;
+  }
+  printf("  cached and shifted draws match: ok\n");
+  return 0;
+}
@@ -0,0 +1,321 @@
+/**
+ ******************************************************************************
+ * @file    swap_bench.c
+ * @brief   LCD_SwapBuffers() diff: word-wide single pass vs the byte diffs
+ ******************************************************************************
+ *
+ * Replays the recorded gameplay frames (frames.h, default frames.bin) as
+ * consecutive frame pairs through the diff engines:
+ * - two-pass byte: the original diff - two byte compare passes over every
+ *   dirty page
+ * - range byte: the diff the word engine replaced - one byte pass over each
+ *   page's dirty column range (user-003)
+ * - word: the word-wide single pass of LCD_SwapBuffers(), byte compares
+ *   only inside words that differ
+ * The three are kept here as diff-only engines that emit runs to a list,
+ * so they are timed like for like: each over the whole recording, several
+ * repetitions. The real LCD_SwapBuffers() is timed too, per pair in DMA
+ * mode (the transfers are retired outside the timing); its figure also
+ * holds run merging, traffic accounting and starting the DMA.
+ *
+ * Operation counts are buffer compares per frame: bytes for the byte
+ * diffs, words plus the bytes inside differing words for the word diff.
+ * Every engine's back buffer must equal the frame after every pair, and
+ * the word engine must produce the same runs as the range byte diff, or
+ * the benchmark fails.
+ *
+ *   ./swap_bench [frames.bin] [repetitions]
+ *
+ ******************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "frames.h"
+
+#define ENGINE_TWO_PASS       0
+#define ENGINE_RANGE          1
+#define ENGINE_WORD           2
+#define ENGINES               3
+
+typedef struct {
+  unsigned char page, col, length;
+} BenchRun;
+
+typedef struct {
+  const char *name;
+  unsigned long (*diff)(const RecordedFrame *frame, unsigned char *back, BenchRun *runs, unsigned int *count);
+  double ns;
+  unsigned long compares;
+} Engine;
+
+static __attribute__ ((aligned (4))) unsigned char engineBack[ENGINES][LCD_BUFFER_SIZE];
+static BenchRun engineRuns[ENGINES][LCD_BUFFER_SIZE];
+static unsigned int engineRunCount[ENGINES];
+
+/*******************************************************************************
+* Function Name  : NowNs
+* Description    : Monotonic clock in nanoseconds
+*******************************************************************************/
+static double NowNs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*******************************************************************************
+* Function Name  : AddRun
+* Description    : Append one run to an engine's list
+*******************************************************************************/
+static void AddRun(BenchRun *runs, unsigned int *count, unsigned char page, unsigned char col, unsigned char length)
+{
+  runs[*count].page = page;
+  runs[*count].col = col;
+  runs[*count].length = length;
+  (*count)++;
+}
+
+/*******************************************************************************
+* Function Name  : TwoPassDiff
+* Description    : The original LCD_SwapBuffers() diff: per dirty page, one
+*                  pass for the changed column span, a second to split it
+*                  into runs
+* Input          : frame -- current frame, back -- previous one
+* Output         : back updated, runs/count
+* Return         : Byte compares made
+*******************************************************************************/
+static unsigned long TwoPassDiff(const RecordedFrame *frame, unsigned char *back, BenchRun *runs, unsigned int *count)
+{
+  const unsigned char *cur = frame->buffer;
+  unsigned long compares = 0;
+  unsigned char page, col, startCol, endCol, runCol;
+  unsigned int offset;
+
+  *count = 0;
+  for (page = 0; page < LCD_PAGES; page++) {
+    if (frame->dirtyColMin[page] >= LCD_WIDTH) continue;
+
+    startCol = 255;
+    endCol = 0;
+    for (col = 0; col < LCD_WIDTH; col++) {
+      offset = (unsigned int)page * LCD_WIDTH + col;
+      compares++;
+      if (cur[offset] != back[offset]) {
+        if (startCol == 255) startCol = col;
+        endCol = col;
+      }
+    }
+    if (startCol == 255) continue;
+
+    col = startCol;
+    while (col <= endCol) {
+      offset = (unsigned int)page * LCD_WIDTH + col;
+      while (col <= endCol && (compares++, cur[offset] == back[offset])) {
+        col++;
+        offset++;
+      }
+      if (col > endCol) break;
+      runCol = col;
+      while (col <= endCol && (compares++, cur[offset] != back[offset])) {
+        back[offset] = cur[offset];
+        col++;
+        offset++;
+      }
+      AddRun(runs, count, page, runCol, col - runCol);
+    }
+  }
+  return compares;
+}
+
+/*******************************************************************************
+* Function Name  : RangeDiff
+* Description    : The diff before the word engine: one pass over each
+*                  page's dirty column range, skipping equal bytes and
+*                  copying each run of changed ones
+* Input          : frame -- current frame, back -- previous one
+* Output         : back updated, runs/count
+* Return         : Byte compares made
+*******************************************************************************/
+static unsigned long RangeDiff(const RecordedFrame *frame, unsigned char *back, BenchRun *runs, unsigned int *count)
+{
+  const unsigned char *cur = frame->buffer;
+  unsigned long compares = 0;
+  unsigned char page, col, endCol, runCol;
+  unsigned int offset;
+
+  *count = 0;
+  for (page = 0; page < LCD_PAGES; page++) {
+    if (frame->dirtyColMin[page] >= LCD_WIDTH) continue;
+
+    col = frame->dirtyColMin[page];
+    endCol = frame->dirtyColMax[page];
+    offset = (unsigned int)page * LCD_WIDTH + col;
+    while (col <= endCol) {
+      compares++;
+      if (cur[offset] == back[offset]) {
+        col++;
+        offset++;
+        continue;
+      }
+      runCol = col;
+      do {
+        back[offset] = cur[offset];
+        col++;
+        offset++;
+      } while (col <= endCol && (compares++, cur[offset] != back[offset]));
+      AddRun(runs, count, page, runCol, col - runCol);
+    }
+  }
+  return compares;
+}
+
+/*******************************************************************************
+* Function Name  : WordDiff
+* Description    : The LCD_SwapBuffers() diff: the dirty range in 32-bit
+*                  words, bytes only inside words that differ, each run
+*                  emitted as soon as its end is found
+* Input          : frame -- current frame, back -- previous one (aligned)
+* Output         : back updated, runs/count
+* Return         : Word and byte compares made
+*******************************************************************************/
+static unsigned long WordDiff(const RecordedFrame *frame, unsigned char *back, BenchRun *runs, unsigned int *count)
+{
+  const unsigned char *cur = frame->buffer;
+  uint32_t curWord, backWord;
+  unsigned long compares = 0;
+  unsigned char page, b, col = 0, runCol = 0, inRun;
+  unsigned int word, lastWord, offset;
+
+  *count = 0;
+  for (page = 0; page < LCD_PAGES; page++) {
+    if (frame->dirtyColMin[page] >= LCD_WIDTH) continue;
+
+    word = (unsigned int)page * (LCD_WIDTH / 4) + frame->dirtyColMin[page] / 4;
+    lastWord = (unsigned int)page * (LCD_WIDTH / 4) + frame->dirtyColMax[page] / 4;
+    inRun = 0;
+    for (; word <= lastWord; word++) {
+      compares++;
+      memcpy(&curWord, cur + 4 * word, 4);
+      memcpy(&backWord, back + 4 * word, 4);
+      if (curWord == backWord) {
+        if (inRun) {
+          col = (word % (LCD_WIDTH / 4)) * 4;
+          AddRun(runs, count, page, runCol, col - runCol);
+          inRun = 0;
+        }
+        continue;
+      }
+      offset = word * 4;
+      col = (word % (LCD_WIDTH / 4)) * 4;
+      for (b = 0; b < 4; b++, offset++, col++) {
+        compares++;
+        if (cur[offset] != back[offset]) {
+          back[offset] = cur[offset];
+          if (!inRun) {
+            runCol = col;
+            inRun = 1;
+          }
+        } else if (inRun) {
+          AddRun(runs, count, page, runCol, col - runCol);
+          inRun = 0;
+        }
+      }
+    }
+    if (inRun) AddRun(runs, count, page, runCol, col - runCol);
+  }
+  return compares;
+}
+
+static Engine engines[ENGINES] = {
+  {"two-pass byte diff", TwoPassDiff, 0, 0},
+  {"range byte diff   ", RangeDiff, 0, 0},
+  {"word diff         ", WordDiff, 0, 0}
+};
+
+int main(int argc, char **argv)
+{
+  const char *path = argc > 1 ? argv[1] : "frames.bin";
+  int reps = argc > 2 ? atoi(argv[2]) : 200;
+  Recording rec;
+  double swapNs = 0, timerNs, t0;
+  unsigned long pairs;
+  unsigned int i, e;
+  int r;
+
+  if (Frames_Load(&rec, path) != 0 || rec.count < 2) {
+    fprintf(stderr, "cannot load %s\n", path);
+    return 1;
+  }
+  pairs = rec.count - 1;
+
+  // Correctness and operation counts: one pass, every pair checked
+  for (e = 0; e < ENGINES; e++) {
+    memcpy(engineBack[e], rec.frame[0].buffer, LCD_BUFFER_SIZE);
+  }
+  for (i = 1; i < rec.count; i++) {
+    for (e = 0; e < ENGINES; e++) {
+      engines[e].compares += engines[e].diff(&rec.frame[i], engineBack[e], engineRuns[e], &engineRunCount[e]);
+      if (memcmp(engineBack[e], rec.frame[i].buffer, LCD_BUFFER_SIZE) != 0) {
+        fprintf(stderr, "frame %u: %s back buffer differs from the frame\n", i, engines[e].name);
+        return 1;
+      }
+    }
+    if (engineRunCount[ENGINE_WORD] != engineRunCount[ENGINE_RANGE] ||
+        memcmp(engineRuns[ENGINE_WORD], engineRuns[ENGINE_RANGE],
+               engineRunCount[ENGINE_WORD] * sizeof(BenchRun)) != 0) {
+      fprintf(stderr, "frame %u: word diff runs differ from the byte diff\n", i);
+      return 1;
+    }
+  }
+
+  // Timing: each engine over the whole recording, reps times
+  for (e = 0; e < ENGINES; e++) {
+    for (r = 0; r < reps; r++) {
+      memcpy(engineBack[e], rec.frame[0].buffer, LCD_BUFFER_SIZE);
+      t0 = NowNs();
+      for (i = 1; i < rec.count; i++) {
+        engines[e].diff(&rec.frame[i], engineBack[e], engineRuns[e], &engineRunCount[e]);
+      }
+      engines[e].ns += NowNs() - t0;
+    }
+  }
+
+  // The real thing, per pair (the frame has to be put in place first)
+  t0 = NowNs();
+  for (i = 0; i < 100000; i++) (void)NowNs();
+  timerNs = (NowNs() - t0) / 100000;
+
+  LCD_Emu_Reset();
+  LCD_InitFrameBuffer();
+  LCD_InitDMA();
+  LCD_SetFlushMode(LCD_FLUSH_MODE_DMA);
+  for (r = 0; r < reps; r++) {
+    memcpy(backBuffer, rec.frame[0].buffer, LCD_BUFFER_SIZE);
+    for (i = 1; i < rec.count; i++) {
+      Frames_Apply(&rec.frame[i]);
+      t0 = NowNs();
+      LCD_SwapBuffers();
+      swapNs += NowNs() - t0 - timerNs;
+      LCD_WaitFlush();
+      if (memcmp(backBuffer, rec.frame[i].buffer, LCD_BUFFER_SIZE) != 0) {
+        fprintf(stderr, "frame %u: LCD_SwapBuffers back buffer differs from the frame\n", i);
+        return 1;
+      }
+    }
+  }
+
+  printf("%s: %u frames, %lu pairs x %d repetitions\n", path, rec.count, pairs, reps);
+  for (e = 0; e < ENGINES; e++) {
+    printf("  %s : %7.1f ns/frame  %6.1f compares/frame\n", engines[e].name,
+           engines[e].ns / ((double)pairs * reps), (double)engines[e].compares / pairs);
+  }
+  printf("  LCD_SwapBuffers()  : %7.1f ns/frame  (diff + merge + accounting + DMA start)\n",
+         swapNs / ((double)pairs * reps));
+  Frames_Free(&rec);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file    clock.h
+ * @brief   System clock profiles (oscillator, PLL, flash wait states, buses)
+ ******************************************************************************
+ *
+ * Clock_Config() replaces the fixed 8 MHz HSI setup. Each profile sets:
+ * - SYSCLK source and PLL multiplier
+ * - flash wait states (0 up to 24 MHz, 1 up to 48 MHz, 2 above) + prefetch
+ * - APB1 /2 above 36 MHz (its limit); AHB and APB2 undivided
+ * - ADC prescaler, the smallest that keeps the ADC clock <= 14 MHz
+ * - SysTick at 1 kHz from the new HCLK
+ *
+ * Everything that counts HCLK is then derived from SystemCoreClock:
+ * TIM1 runs at CLOCK_TIM1_TICK_HZ whatever the profile (Clock_Tim1Prescaler),
+ * so the SIM_TICK_PERIOD tick time in sim.h does not change; USART1 gets
+ * its BRR from HAL_UART_Init(); the LCD FSMC timing from LCD_BusTimingInit().
+ * All three run after SystemClock_Config() in main().
+ *
+ * Clock_Switch() changes profile at run time (e.g. CLOCK_PROFILE_MENU on the
+ * start/end screens, CLOCK_PROFILE_DEFAULT in the game). SysTick and the
+ * ADC prescaler are redone here; the change callback re-derives what the
+ * application owns (TIM1 PSC, USART1 BRR, LCD_BusTimingInit()). The switch,
+ * callback included, is timed with the DWT cycle counter.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include "stm32f1xx_hal.h"
+
+// Profiles
+#define CLOCK_HSI_8MHZ        0   // HSI direct, no PLL (the original setup)
+#define CLOCK_HSI_PLL_36MHZ   1   // HSI/2 x 9
+#define CLOCK_HSI_PLL_64MHZ   2   // HSI/2 x 16, fastest without a crystal
+#define CLOCK_HSE_PLL_72MHZ   3   // 8 MHz HSE x 9; falls back to HSI_PLL_64 if HSE fails
+#define CLOCK_PROFILES        4
+
+#ifndef CLOCK_PROFILE_DEFAULT
+#define CLOCK_PROFILE_DEFAULT CLOCK_HSE_PLL_72MHZ
+#endif
+
+#ifndef CLOCK_PROFILE_MENU
+#define CLOCK_PROFILE_MENU    CLOCK_HSI_8MHZ    // Start and game over screens
+#endif
+
+#define CLOCK_TIM1_TICK_HZ    10000   // TIM1 counter rate; SIM_TICK_PERIOD is in these counts
+#define CLOCK_ADC_MAX_HZ      14000000
+
+unsigned char Clock_Config(unsigned char profile);      // Returns the profile actually running
+unsigned char Clock_GetProfile(void);
+uint32_t Clock_Tim1Prescaler(void);                     // PSC for CLOCK_TIM1_TICK_HZ at the current PCLK2
+
+unsigned char Clock_Switch(unsigned char profile);      // Run-time change; returns the profile running
+void Clock_SetChangeCallback(void (*callback)(void));   // Called after every switch, before timing stops
+uint32_t Clock_GetLastSwitchUs(void);
+uint32_t Clock_GetMaxSwitchUs(void);
+void Clock_Dump(void (*write)(const char *text, unsigned int length));
+
+#endif /* __CLOCK_H */
@@ -0,0 +1,35 @@
+/**
+ ******************************************************************************
+ * @file    fmt.h
+ * @brief   Minimal text formatting for the UART dumps (no printf)
+ ******************************************************************************
+ *
+ * Every dump builds its lines in a char buffer the same way:
+ *
+ *   pos = Fmt_AppendText(line, 0, "sim ticks=");
+ *   pos = Fmt_AppendUInt(line, pos, stats.ticks);
+ *   pos = Fmt_AppendText(line, pos, "\r\n");
+ *   write(line, pos);
+ *
+ * Each call writes at pos and returns the position after what it wrote.
+ * Nothing is terminated and nothing is bounds-checked: the caller sizes
+ * the buffer for the longest line it can produce (a uint32_t is at most
+ * 10 digits).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __FMT_H
+#define __FMT_H
+
+#ifdef HOST_BUILD
+#include <stdint.h>
+#else
+#include "stm32f1xx_hal.h"
+#endif
+
+unsigned int Fmt_AppendText(char *buf, unsigned int pos, const char *text);
+unsigned int Fmt_AppendUInt(char *buf, unsigned int pos, uint32_t value);     // Decimal
+unsigned int Fmt_AppendHex(char *buf, unsigned int pos, uint32_t value, unsigned char digits);  // Upper case, zero padded
+
+#endif /* __FMT_H */
@@ -17,9 +17,10 @@
  * 1. Create a DinoGameState: DinoGameState game;
  * 2. Initialize it: initGameState(&game);
  * 3. In game loop:
- *    - Clear old position: clearSprite(game.dinoX, game.dinoY, 2);
+ *    - Remember the old row: oldRow = Q8_INT(game.dinoRow);
  *    - Update game logic: handleJump(&game); updateDinoAnimation(&game);
- *    - Draw new position: drawDino(&game);
+ *    - Erase and redraw in one pass: moveDino(&game, oldRow);
+ *      (or clearSprite() before the update and drawDino() after it)
  * 
  ******************************************************************************
  */
@@ -27,7 +28,11 @@
 #ifndef __FUNCTION_H
 #define __FUNCTION_H
 
+#ifdef HOST_BUILD
+#include <stdint.h>
+#else
 #include "main.h"
+#endif
 #include "lcd.h"
 
 // Game sprite indices in ChineseTable (8x16 format)
@@ -47,71 +52,97 @@
 // Game constants
 #define GROUND_PAGE          7    // The page/row where ground is drawn (bottom of LCD)
 #define DINO_GROUND_Y        64   // Dino's Y position when on ground
-#define JUMP_MAX_HEIGHT      3    // Maximum jump height in pages
-#define JUMP_HANG_TIME_MIN   12   // Normal hang time at jump peak (when button released)
-#define JUMP_HANG_TIME_MAX   30   // Maximum hang time at jump peak (when button held)
-#define OBSTACLE_SPEED_INIT  8    // Initial frames between obstacle movements (higher = slower)
-#define OBSTACLE_SPEED_MIN   2    // Minimum obstacle speed (fastest)
-#define SPEED_INCREASE_RATE  300  // Frames between speed increases (longer = slower difficulty ramp)
+#define SPEED_INCREASE_RATE  300  // Ticks between speed increases (longer = slower difficulty ramp)
+#define MAX_OBSTACLES        3    // Allow multiple obstacles on screen simultaneously
 
-// PWM Timer period constants (lower = faster frame rate)
-// Timer tick = 10kHz, so period 100 = 100Hz (10ms/frame)
-#define TIMER_PERIOD_INIT    150  // Initial: 15ms per frame ≈ 66 FPS
-#define TIMER_PERIOD_MIN     80   // Minimum: 8ms per frame ≈ 125 FPS max
-#define TIMER_SPEED_STEP     2    // How much to decrease period each speed increase
+// Q8.8 fixed point (8 fraction bits): positions and velocities stay integer,
+// no soft-float on the Cortex-M3. Q8_INT rounds down for negative values
+// too (obstacles leaving on the left); >> of a negative number is
+// implementation-defined in C, so it divides explicitly.
+#define Q8(n)                ((n) * 256)
+#define Q8_INT(q)            Q8_Floor(q)
 
-// Obstacle spawn interval constants (frames between spawns)
-#define OBSTACLE_SPAWN_MIN   60   // Minimum frames between obstacle spawns
-#define OBSTACLE_SPAWN_MAX   150  // Maximum frames between obstacle spawns
+static inline int32_t Q8_Floor(int32_t q)
+{
+    return q >= 0 ? q / 256 : -((255 - q) / 256);
+}
 
-// Animation speed (frames between animation updates)
-#define DINO_ANIM_SPEED      4    // Update dino animation every N frames
-#define JUMP_PHYSICS_SPEED   3    // Update jump physics every N frames
+// Dino physics, in pixel rows (down = +) and simulation ticks. Take-off
+// velocity and gravity give a JUMP_HEIGHT rise in 9 ticks; the dino then
+// hangs at the apex, longer while the button is held, and falls back.
+#define DINO_GROUND_ROW      40   // Top row on the ground (page 5, ground line at row 56)
+#define JUMP_HEIGHT          24   // Apex this many pixels above the ground row
+#define JUMP_VELOCITY        1233 // Take-off speed, Q8.8 rows/tick (4.8)
+#define JUMP_GRAVITY         137  // Q8.8 rows/tick added every tick (0.54)
+#define JUMP_HANG_TIME_MIN   36   // Ticks at the apex (when button released)
+#define JUMP_HANG_TIME_MAX   90   // Maximum ticks at the apex (when button held)
+#define DINO_HIT_INSET       3    // Dino hitbox inset from the 16x16 sprite edges
+
+// Game logic runs in fixed simulation ticks (SIM_TICK_PERIOD in sim.h,
+// 15ms), independent of how often the screen is redrawn. Difficulty is the
+// world speed: how far obstacles scroll per tick, in Q8.8 columns.
+#define WORLD_SPEED_INIT     256  // 1 column/tick ≈ 67 px/s
+#define WORLD_SPEED_MAX      1920 // 7.5 columns/tick ≈ 500 px/s
+#define WORLD_SPEED_STEP     48   // Added every SPEED_INCREASE_RATE ticks
+#define OBSTACLE_SPAWN_COL   LCD_WIDTH  // Column new obstacles appear at, just off the right edge
+#define OBSTACLE_EXIT_COL    (-16)      // Fully off the left edge here: passed (score)
+
+// Obstacle spawn interval constants (ticks between spawns)
+#define OBSTACLE_SPAWN_MIN   60   // Minimum ticks between obstacle spawns
+#define OBSTACLE_SPAWN_MAX   150  // Maximum ticks between obstacle spawns
+
+// Animation speed (ticks between animation updates)
+#define DINO_ANIM_SPEED      4    // Update dino animation every N ticks
 
 // Game state and animation variables
 typedef struct {
-    unsigned char dinoX;          // Dino X position (page)
+    int16_t dinoRow;              // Dino top pixel row, Q8.8 (Q8(DINO_GROUND_ROW) on the ground)
+    int16_t dinoVel;              // Vertical velocity, Q8.8 rows per tick (negative = up)
     unsigned char dinoY;          // Dino Y position (column)
     unsigned char dinoState;      // 0=running, 1=jumping, 2=ducking
     unsigned char animFrame;      // Animation frame counter
-    unsigned char jumpHeight;     // Current jump height
-    unsigned char isJumping;      // Jump state flag
+    unsigned char isJumping;      // Rising or hanging at the apex (falling is !isJumping above ground)
     unsigned char jumpHangCounter; // Counter for hang time at peak
     unsigned char buttonHeld;     // Whether jump button is being held
     unsigned char lives;          // Number of lives (1-4)
     unsigned int score;           // Current game score
-    unsigned char currentSpeed;   // Current obstacle speed (frames between moves)
+    uint16_t worldSpeed;          // Obstacle scroll speed, Q8 columns per tick
     unsigned int speedTimer;      // Timer for speed increases
     unsigned char animTimer;      // Timer for animation updates
-    unsigned char physicsTimer;   // Timer for physics updates
 } DinoGameState;
 
 // Obstacle structure
 typedef struct {
     unsigned char x;              // X position (page)
-    unsigned char y;              // Y position (column)
     unsigned char type;           // 0=cactus big, 1=cactus small, 2=bird
     unsigned char active;         // Is obstacle active
+    int16_t y;                    // Y position (column) it is drawn at - Q8_INT(yQ8), off screen < 0 or > 127
+    int32_t yQ8;                  // Column, Q8.8 - moves left by the world speed
 } Obstacle;
 
 // Game functions
 void drawDino(DinoGameState *state);
+void moveDino(DinoGameState *state, unsigned char fromRow);  // Erase at fromRow + draw, one pass
 void drawDinoDead(DinoGameState *state);  // Draw dead dino sprite
 void updateDinoAnimation(DinoGameState *state);
-void drawCactus(unsigned char x, unsigned char y, unsigned char type);
+void drawCactus(unsigned char x, signed short y, unsigned char type);  // y may be partly off screen
+void moveCactus(unsigned char x, signed short fromY, signed short toY, unsigned char type);  // One pass
 void drawStar(unsigned char x, unsigned char y);
 void drawMoon(unsigned char x, unsigned char y);
 void drawGroundLine(unsigned char y);
-void clearSprite(unsigned char x, unsigned char y, unsigned char width);
+void cacheSprites(void);  // Pre-shift the dino and cactus glyphs, build masks (startup)
+void clearSprite(unsigned char row, signed short col, unsigned char width);  // 16 rows from a pixel row, clipped
 void initGameState(DinoGameState *state);
-void handleJump(DinoGameState *state);
-void updateObstacle(Obstacle *obs);
+unsigned char isOnGround(DinoGameState *state);
+void startJump(DinoGameState *state);
+void handleJump(DinoGameState *state);  // Every tick
+unsigned char obstacleHit(DinoGameState *state, Obstacle *obs);  // Pixel hitbox overlap
 void drawScore(unsigned int score, unsigned char x, unsigned char y);
 void drawStartScreen(void);
 void clearStartScreen(void);
 void drawEndScreen(void);
 void clearEndScreen(void);
 void updateLivesLED(unsigned char lives);
-void updateGameSpeed(DinoGameState *state);  // PWM-based speed control
+void updateGameSpeed(DinoGameState *state);  // Raise the world speed over time
 
 #endif /* __FUNCTION_H */
\ No newline at end of file
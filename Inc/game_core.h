@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file    game_core.h
+ * @brief   Platform-free game step: one call advances the game one tick
+ ******************************************************************************
+ *
+ * USAGE:
+ * ------
+ *   GameCore core;
+ *   GameCore_Init(&core, Prng_GameSeed(), lives);
+ *   while (GameCore_Step(&core, inputBits, &io) == GAME_STEP_RUNNING) {
+ *     ...wait for the next simulation tick...
+ *   }
+ *
+ * One step is one fixed simulation tick (SIM_TICK_PERIOD, sim.h); how fast
+ * the game plays is the world speed in the DinoGameState, never the step
+ * rate. GameCore holds everything a game is made of - the DinoGameState,
+ * the obstacles, the spawn schedule and both random streams - and
+ * GameCore_Step() touches nothing else. Whatever the tick should do outside
+ * that state (draw into the frame buffer, set the lives LEDs, mark profiler
+ * phases) goes through the GameIO callbacks. A sprite that moves is erased
+ * and redrawn by one move call, so the platform can write each byte once.
+ * Every callback may be NULL, so a host build can run the game headless,
+ * millions of ticks per second, for tuning and regression runs; the same
+ * seed and input bits give the same game on both.
+ *
+ * The input is a bitmask per tick: GAME_INPUT_BUTTON is the button level,
+ * GAME_INPUT_PRESS that a press happened since the previous tick (so a tap
+ * shorter than a tick still jumps).
+ *
+ ******************************************************************************
+ */
+
+#ifndef __GAME_CORE_H
+#define __GAME_CORE_H
+
+#include "function.h"
+#include "prng.h"
+
+// Per-tick input bits
+#define GAME_INPUT_BUTTON     0x01  // Jump button held
+#define GAME_INPUT_PRESS      0x02  // Jump button pressed since the last tick
+
+// GameCore_Step() results
+#define GAME_STEP_RUNNING     0
+#define GAME_STEP_OVER        1     // Last life lost this tick (or earlier)
+
+#define GAME_FIRST_SPAWN      10    // Ticks before the first obstacle
+
+typedef struct {
+  void (*clearSprite)(unsigned char row, signed short col, unsigned char width);  // 16 rows from a pixel row
+  void (*moveDino)(DinoGameState *state, unsigned char fromRow);                 // Erase at fromRow, draw at dinoRow
+  void (*moveCactus)(unsigned char x, signed short fromY, signed short toY, unsigned char type);  // Clipped at the edges
+  void (*setLives)(unsigned char lives);        // Lives LEDs, every tick
+  void (*mark)(unsigned char phase);            // End of a PROF_* phase
+} GameIO;
+
+typedef struct {
+  DinoGameState state;
+  Obstacle obstacles[MAX_OBSTACLES];
+  PrngStream spawnRandom;     // Frames between spawns
+  PrngStream typeRandom;      // Obstacle types
+  unsigned int tickCount;     // GameCore_Step() calls
+  unsigned int nextObstacleSpawn;
+  unsigned char over;         // Set with the last life
+} GameCore;
+
+void GameCore_Init(GameCore *core, uint32_t seed, unsigned char lives);
+unsigned char GameCore_Step(GameCore *core, unsigned char input, const GameIO *io);
+
+#endif /* __GAME_CORE_H */
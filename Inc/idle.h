@@ -0,0 +1,44 @@
+/**
+ ******************************************************************************
+ * @file    idle.h
+ * @brief   Sleep-until-interrupt idle and CPU utilization counters
+ ******************************************************************************
+ *
+ * Instead of spinning, waits put the core to sleep with WFI until an
+ * interrupt (TIM1 update, SysTick, DMA, EXTI, ...) wakes it:
+ * - Idle_WaitFlag() sleeps until an interrupt handler sets a flag
+ *   (e.g. gameTimerFlag), without the check-then-sleep race
+ * - Idle_WaitEvent() sleeps until any interrupt, for loops that poll state
+ *   the interrupts update
+ *
+ * Time asleep is measured with the profiler's tick source (profiler.h) and
+ * summed, so utilization = (wall - sleep) / wall is measured per frame and
+ * overall. Call Idle_EndFrame() once per game frame and Idle_AbortFrame()
+ * when leaving the game loop.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __IDLE_H
+#define __IDLE_H
+
+#include "profiler.h"
+
+typedef struct {
+  uint64_t wallTicks;           // Since Idle_Init()
+  uint64_t sleepTicks;          // Of which spent in WFI
+  uint32_t frames;
+  uint32_t lastUtilPermille;    // Active share of the last frame
+  uint32_t maxUtilPermille;     // Busiest frame so far
+} IdleStats;
+
+void Idle_Init(void);                                   // After Prof_Init()
+void Idle_WaitFlag(volatile unsigned char *flag);       // Sleep until *flag != 0
+void Idle_WaitEvent(void);                              // Sleep until the next interrupt
+void Idle_EndFrame(void);
+void Idle_AbortFrame(void);                             // Drop the open frame (e.g. leaving the game loop)
+void Idle_GetStats(IdleStats *stats);
+uint32_t Idle_UtilPermille(void);                       // Overall active share
+void Idle_Dump(void (*write)(const char *text, unsigned int length));
+
+#endif /* __IDLE_H */
@@ -0,0 +1,50 @@
+/**
+ ******************************************************************************
+ * @file    input.h
+ * @brief   Interrupt-driven jump button with debounce and an event queue
+ ******************************************************************************
+ *
+ * The button (PA0, active high) raises EXTI0 on both edges. The first edge
+ * that changes the debounced level is taken at once, so a press is seen with
+ * no added latency; edges during the following INPUT_DEBOUNCE_MS are bounce
+ * and ignored. When the lockout ends (checked from SysTick) the pin is read
+ * again, so a level change hidden in the bounce is not lost.
+ *
+ * Every accepted press/release goes into a single-producer/single-consumer
+ * ring with its HAL_GetTick() and cycle-counter time. The producer side runs
+ * in EXTI0 and SysTick, which share a priority and so never preempt each
+ * other; the main loop is the only consumer (Input_Poll). Presses shorter
+ * than a frame are therefore still seen.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __INPUT_H
+#define __INPUT_H
+
+#include "stm32f1xx_hal.h"
+
+#define BUTTON_PIN            GPIO_PIN_0  // Change to your actual button pin
+#define BUTTON_PORT           GPIOA       // Change to your actual button port
+#define BUTTON_EXTI_IRQn      EXTI0_IRQn  // EXTI line of BUTTON_PIN
+
+#define INPUT_DEBOUNCE_MS     20
+#define INPUT_QUEUE_SIZE      16          // Power of two
+
+typedef struct {
+  unsigned char pressed;      // 1 -- press, 0 -- release
+  uint32_t tick;              // HAL_GetTick() at the edge
+  uint32_t cycles;            // Prof_Now() at the edge
+} InputEvent;
+
+void Input_Init(void);                          // After MX_GPIO_Init() and Prof_Init()
+unsigned char Input_Poll(InputEvent *event);    // 1 -- event taken from the queue
+unsigned char Input_TakePress(void);            // Drop events up to the first press; 1 if there was one
+void Input_Flush(void);                         // Drop every queued event
+void Input_Dump(void (*write)(const char *text, unsigned int length));    // Events lost to a full queue
+
+// Interrupt side
+void Input_EdgeIRQ(void);                       // From HAL_GPIO_EXTI_Callback
+void Input_TickIRQ(void);                       // From SysTick_Handler
+
+#endif /* __INPUT_H */
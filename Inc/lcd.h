@@ -1,7 +1,12 @@
 #ifndef __LCD_H
 #define __LCD_H
 
+#ifdef HOST_BUILD
+#include "lcd_host.h"
+#include "lcd_emu.h"
+#else
 #include "stm32f1xx_hal.h"
+#endif
 
 #define Reset_LCD         0xe2
 
@@ -31,10 +36,28 @@
 #define Display_All_On    0xa5
 #define Display_All_Normal  0xa4
 // ZYMG12864
+#define LCD_CMD_ADDR   0x6c000000
+#define LCD_DATA_ADDR  0x6c000001
+#ifndef HOST_BUILD
 /*A0=0  -- cmd*/
-#define LCD_Command  *((volatile unsigned char * )0x6c000000)
+#define LCD_Command  *((volatile unsigned char * )LCD_CMD_ADDR)
 /*A0=1 -- data*/
-#define LCD_Data  *((volatile unsigned char * )0x6c000001)
+#define LCD_Data  *((volatile unsigned char * )LCD_DATA_ADDR)
+/*A0=0 read -- status register*/
+#define LCD_Status  *((volatile unsigned char * )LCD_CMD_ADDR)
+
+/* Bus accesses - plain volatile FSMC accesses on the MCU, the controller
+   model in lcd_emu.c on the host */
+#define LCD_BUS_WRITE_CMD(c)     (LCD_Command = (c))
+#define LCD_BUS_WRITE_DATA(d)    (LCD_Data = (d))
+#define LCD_BUS_READ_DATA()      (LCD_Data)
+#define LCD_BUS_READ_STATUS()    (LCD_Status)
+#else
+#define LCD_BUS_WRITE_CMD(c)     LCD_Emu_WriteCmd(c)
+#define LCD_BUS_WRITE_DATA(d)    LCD_Emu_WriteData(d)
+#define LCD_BUS_READ_DATA()      LCD_Emu_ReadData()
+#define LCD_BUS_READ_STATUS()    LCD_Emu_ReadStatus()
+#endif
 
 /*define the constant for display digital char*/
 #define	D0		0
@@ -125,9 +148,9 @@ void LCD_DisplayOff(void);
 void LCD_CtrlLinesConfig(void);
 void LCD_FSMCConfig(void);
 
-void delay(void);
-void reset_delay(void);
-void power_delay(void);
+void delay(void);                                       // One bus cycle wait (LCD_BusWait)
+void reset_delay(void);                                 // Wait for the controller to leave reset
+void power_delay(void);                                 // Booster/regulator settling time
 
 void LCD_Draw_ST_Logo(void);
 void LCD_Reset_Cursor(void);
@@ -160,6 +183,8 @@ unsigned char LCD_SetArea(unsigned char x1, unsigned char y1, unsigned char x2,
 extern unsigned char frameBuffer[LCD_BUFFER_SIZE];      // Current frame buffer
 extern unsigned char backBuffer[LCD_BUFFER_SIZE];       // Previous frame for comparison
 extern unsigned char dirtyPages[LCD_PAGES];             // Track which pages need update
+extern unsigned char dirtyColMin[LCD_PAGES];            // First written column per page (LCD_WIDTH = none)
+extern unsigned char dirtyColMax[LCD_PAGES];            // Last written column per page
 
 // Double buffer functions
 void LCD_InitFrameBuffer(void);                         // Initialize frame buffers
@@ -175,4 +200,178 @@ unsigned char LCD_Buffer_DrawString(unsigned char Xpage, unsigned char YCol, uns
 void LCD_Buffer_ClearArea(unsigned char page, unsigned char col, unsigned char width);
 void LCD_Buffer_SetByte(unsigned char page, unsigned char col, unsigned char data);
 
+// Sub-page blitter: glyphs OR-ed in at any pixel row and any column, the
+// part off the left or right edge clipped. Glyphs added to the
+// cache are pre-shifted for all 8 row offsets (192 bytes each); build with
+// -DLCD_GLYPH_CACHE_SLOTS=0 to leave the cache out and shift on every draw.
+#ifndef LCD_GLYPH_CACHE_SLOTS
+#define LCD_GLYPH_CACHE_SLOTS  12
+#endif
+void LCD_Buffer_DrawGlyph(unsigned char row, signed short col, unsigned char offset);  // 8x16 at any pixel row, OR-ed
+void LCD_Buffer_DrawSprite(unsigned char row, signed short col, unsigned char offset, unsigned char width);  // width glyphs
+unsigned char LCD_GlyphCache_Add(unsigned char offset);  // Pre-shift a hot glyph; 0 -- no slot
+
+// Raster ops: how sprite bits inside the transparency mask combine with the
+// frame buffer (outside the mask it is left alone)
+#define LCD_ROP_COPY         0    // Mask area takes the sprite (set and clear)
+#define LCD_ROP_OR           1    // Sprite pixels set
+#define LCD_ROP_ANDNOT       2    // Sprite pixels cleared
+#define LCD_ROP_XOR          3    // Sprite pixels inverted
+void LCD_Buffer_BlitGlyph(unsigned char row, signed short col, unsigned char offset,
+                          const unsigned char *mask, unsigned char rop);  // mask: 16 bytes, NULL -- see lcd.c
+void LCD_Buffer_BlitSprite(unsigned char row, signed short col, unsigned char offset, unsigned char width,
+                           const unsigned char *mask, unsigned char rop);  // mask: width * 16 bytes
+void LCD_MakeGlyphMask(unsigned char offset, unsigned char *mask);  // Opaque inside each column's outline
+
+// Background layer: static scenery that erasing restores instead of zeros
+void LCD_Background_Capture(void);                      // frameBuffer as it is now becomes the background
+void LCD_Background_Clear(void);
+void LCD_Buffer_RestoreRect(signed short x1, signed short y1, signed short x2, signed short y2);  // Clipped
+
+// Moving a sprite: erase at the old position and draw at the new one in a
+// single pass over the union of both footprints, each byte written once
+#define LCD_SPRITE_MAX_WIDTH  2   // Glyphs side by side (16x16)
+typedef struct {
+  unsigned char offset;       // First glyph in ChineseTable
+  unsigned char width;        // Glyphs side by side (1 - LCD_SPRITE_MAX_WIDTH)
+} LCD_Sprite;
+typedef struct {
+  unsigned char row;          // Top pixel row (0-63)
+  signed short col;           // Left column, may be off either edge
+} LCD_SpritePos;
+void LCD_Buffer_MoveSprite(const LCD_SpritePos *from, const LCD_SpritePos *to, const LCD_Sprite *sprite);
+
+// Buffered pixel/shape primitives - same coordinates and return values as the
+// direct LCD_* versions, but they rasterize into frameBuffer with bit masks
+// and go out with the next LCD_SwapBuffers()
+unsigned char LCD_Buffer_SetPixel(unsigned char x, unsigned char y, unsigned char state);
+unsigned char LCD_Buffer_DrawLine(unsigned char x1, unsigned char x2, unsigned char y, unsigned char state);
+unsigned char LCD_Buffer_DrawVLine(unsigned char x, unsigned char y1, unsigned char y2, unsigned char state);
+unsigned char LCD_Buffer_DrawLineAngle(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1, unsigned char state);
+unsigned char LCD_Buffer_DrawRect(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state);
+unsigned char LCD_Buffer_FillRect(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state);
+unsigned char LCD_Buffer_DrawCircle(unsigned char xc, unsigned char yc, unsigned char radius, unsigned char state);
+unsigned char LCD_Buffer_FillCircle(unsigned char xc, unsigned char yc, unsigned char radius, unsigned char state);
+unsigned char LCD_Buffer_DrawTriangle(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state);
+unsigned char LCD_Buffer_FillTriangle(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state);
+
+// ============================================================================
+// ASYNCHRONOUS FLUSH - dirty runs pushed to LCD_Data by DMA
+// ============================================================================
+// In DMA mode LCD_SwapBuffers()/LCD_FlushBuffer() only diff the buffers and
+// queue the dirty runs; the transfers run from backBuffer while the caller
+// goes on with the next frame. Anything that touches the LCD bus or backBuffer
+// directly must call LCD_WaitFlush() first.
+#define LCD_FLUSH_MODE_CPU   0    // CPU writes every byte (default)
+#define LCD_FLUSH_MODE_DMA   1    // Runs are queued and sent by DMA2 channel 1
+
+#define LCD_FLUSH_IDLE       0
+#define LCD_FLUSH_BUSY       1
+
+#define LCD_DMA_MAX_RUNS     64   // Runs beyond this are written by the CPU
+
+extern DMA_HandleTypeDef hdma_lcd;
+
+void LCD_InitDMA(void);                                 // Configure DMA channel for the LCD
+void LCD_SetFlushMode(unsigned char mode);              // LCD_FLUSH_MODE_CPU / _DMA
+unsigned char LCD_GetFlushStatus(void);                 // LCD_FLUSH_IDLE / _BUSY
+void LCD_WaitFlush(void);                               // Block until the queue is drained
+void LCD_SetFlushCallback(void (*callback)(void));      // Called (from IRQ) when a flush completes
+
+// Address commands are only sent when the controller's cursor (tracked in
+// lcd.c, auto-increment included) is not already there
+unsigned int LCD_GetAddrCmdsSaved(void);                // Left out since the last swap/flush
+unsigned int LCD_GetAddrCmdsSent(void);                 // Sent since the last swap/flush
+
+// ============================================================================
+// RUN MERGING - unchanged gaps resent when that beats re-addressing
+// ============================================================================
+// LCD_SwapBuffers() merges two runs on a page when
+//   gap * dataCost < addressCommands * cmdCost (+ dmaRunCost in DMA mode)
+// Defaults are HCLK cycles at 72 MHz: every FSMC access costs the same (29,
+// see LCD_BusTimingInit), and starting one more DMA run costs an interrupt
+// plus the channel restart.
+#define LCD_COST_CMD_DEFAULT      29
+#define LCD_COST_DATA_DEFAULT     29
+#define LCD_COST_RUN_DMA_DEFAULT  120
+
+typedef struct {
+  unsigned long frames;             // LCD_SwapBuffers() calls
+  unsigned long runsBefore;         // Runs found by the diff
+  unsigned long runsAfter;          // Runs actually sent
+  unsigned long busBytesBefore;     // Address + data bytes without merging
+  unsigned long busBytesAfter;      // Address + data bytes with merging
+} LCD_MergeStats;
+
+void LCD_SetFlushCostModel(unsigned int cmdCost, unsigned int dataCost, unsigned int dmaRunCost);
+void LCD_GetMergeStats(LCD_MergeStats *stats);
+void LCD_ResetMergeStats(void);
+
+// ============================================================================
+// TRAFFIC COUNTERS - bus traffic per LCD_SwapBuffers()/LCD_FlushBuffer()
+// ============================================================================
+// A frame runs from the start of one swap/flush to the start of the next, so
+// it includes its own DMA tail and any direct drawing before the next swap.
+// Each recorded frame goes into a fixed histogram per metric.
+#define LCD_TRAFFIC_CMD      0    // Command bytes
+#define LCD_TRAFFIC_DATA     1    // Data bytes (CPU and DMA)
+#define LCD_TRAFFIC_PAGES    2    // Dirty pages diffed
+#define LCD_TRAFFIC_RUNS     3    // Runs sent
+#define LCD_TRAFFIC_READDR   4    // Address changes that needed commands
+#define LCD_TRAFFIC_METRICS  5
+#define LCD_TRAFFIC_BINS     12   // Pages: one bin per value; others: 0, 1, 2-3, 4-7, ... 1024+
+
+typedef struct {
+  unsigned int cmdBytes;
+  unsigned int dataBytes;
+  unsigned int dirtyPages;
+  unsigned int runs;
+  unsigned int reAddr;
+} LCD_FrameTraffic;
+
+typedef struct {
+  unsigned long frames;
+  unsigned int max[LCD_TRAFFIC_METRICS];
+  unsigned long hist[LCD_TRAFFIC_METRICS][LCD_TRAFFIC_BINS];
+} LCD_TrafficStats;
+
+void LCD_GetLastTraffic(LCD_FrameTraffic *traffic);
+void LCD_GetTrafficStats(LCD_TrafficStats *stats);
+void LCD_ResetTrafficStats(void);
+void LCD_DumpTrafficStats(void (*write)(const char *text, unsigned int length));
+
+// ============================================================================
+// BUS TIMING - minimum waits between LCD bus accesses
+// ============================================================================
+// LCD_BusTimingInit() derives the FSMC bank 4 timing from SystemCoreClock and
+// writes it to the BTR register, so every access meets the controller -
+// LCD_WriteCmd()/LCD_WriteData()/LCD_ReadData() and the DMA flush alike:
+//   DATAST HCLK >= t_PW,  (ADDSET + DATAST + 1) HCLK >= t_CYC
+// e.g. DATAST 16, ADDSET 12 (29 HCLK) at 72 MHz; 8, 6 at 36 MHz; 2, 1 at
+// 8 MHz. Only if the fields ran out would CPU accesses be padded by a spin
+// (LCD_BusWait); DMA ones cannot be, and at the supported clocks the spin
+// count is 0. Call LCD_BusTimingInit() again after changing the core clock.
+#define LCD_FSMC_ADDSET_MAX  15   // BTR field limits (and reset values)
+#define LCD_FSMC_DATAST_MAX  255
+
+// Controller timing (ST7565 class, 8080 bus, VDD 2.7-3.3V)
+#define LCD_T_CYC_NS         400  // Min. system cycle time between accesses
+#define LCD_T_PW_NS          220  // Min. WR/RD low pulse width
+#define LCD_T_RESET_US       2    // Internal reset after LCD_Reset
+#define LCD_T_POWER_MS       50   // Booster/regulator/follower settling
+
+// Status register (A0=0 read)
+#define LCD_STATUS_BUSY      0x80
+#define LCD_STATUS_OFF       0x20
+#define LCD_STATUS_RESET     0x10
+
+#define LCD_SPIN_CYCLES      3    // Fewest CPU cycles one spin iteration can take
+
+void LCD_BusTimingInit(void);                           // Re-derive FSMC timing from SystemCoreClock
+void LCD_GetBusTiming(unsigned char *addset, unsigned char *datast);    // As written to the BTR
+void LCD_BusWait(void);                                 // Wait out the rest of one bus cycle
+void LCD_DelayUs(unsigned int us);                      // Calibrated busy wait
+unsigned char LCD_WaitReady(unsigned int timeoutUs);    // Poll status until not BUSY/RESET
+unsigned int LCD_GetBusWaitLoops(void);                 // Spin count used by LCD_BusWait()
+
 #endif /* __LCD_H */
@@ -0,0 +1,56 @@
+/**
+ ******************************************************************************
+ * @file    lcd_emu.h
+ * @brief   Host (Linux) model of the ST7565-class LCD controller
+ ******************************************************************************
+ *
+ * Only compiled when HOST_BUILD is defined. The LCD_BUS_* macros in lcd.h
+ * route every command/data/status access here instead of the FSMC, so the
+ * whole renderer (direct paths, LCD_SwapBuffers, the DMA stand-in) drives a
+ * software controller:
+ * - page/column registers with auto-increment, start line
+ * - ADC (segment) direction, COM direction, reverse and all-on modes
+ * - read-modify-write mode and the dummy-read latch
+ * - 132 x 65 display RAM (9 pages, page 8 is the icon row)
+ *
+ * Every access is also counted and costed with the FSMC timing, so renderer
+ * changes can be compared by bus bytes and bus time per frame. Accesses the
+ * FSMC timing makes shorter than the controller allows are counted as
+ * timing faults.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __LCD_EMU_H
+#define __LCD_EMU_H
+
+#define LCD_EMU_PAGES   9       // 8 display pages + icon page
+#define LCD_EMU_COLS    132     // Column addresses 0x00-0x83
+
+typedef struct {
+  unsigned long cmdBytes;       // Command writes
+  unsigned long dataBytes;      // Data writes
+  unsigned long readBytes;      // Data and status reads
+  unsigned long busNs;          // Estimated time on the bus
+  unsigned long timingFaults;   // Accesses shorter than t_CYC or t_PW
+} LCD_EmuStats;
+
+// Bus ------------------------------------------------------------------------
+void LCD_Emu_WriteCmd(unsigned char cmd);
+void LCD_Emu_WriteData(unsigned char data);
+unsigned char LCD_Emu_ReadData(void);
+unsigned char LCD_Emu_ReadStatus(void);
+
+// Control --------------------------------------------------------------------
+void LCD_Emu_Reset(void);                               // Power-on state, RAM cleared, stats zeroed
+void LCD_Emu_SetTiming(unsigned int addset, unsigned int datast, unsigned long hclkHz);
+void LCD_Emu_EndFrame(void);                            // Close the current frame's counters
+
+// Inspection -----------------------------------------------------------------
+unsigned char LCD_Emu_GetRam(unsigned char page, unsigned char col);
+unsigned char LCD_Emu_GetPixel(unsigned char x, unsigned char y);   // As seen on the panel
+void LCD_Emu_GetFrameStats(LCD_EmuStats *stats);        // Last closed frame
+void LCD_Emu_GetTotalStats(LCD_EmuStats *stats);        // Since LCD_Emu_Reset()
+unsigned long LCD_Emu_GetFrameCount(void);
+
+#endif /* __LCD_EMU_H */
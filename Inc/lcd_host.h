@@ -0,0 +1,97 @@
+/**
+ ******************************************************************************
+ * @file    lcd_host.h
+ * @brief   Host (Linux) stand-ins for the HAL pieces used by the LCD driver
+ ******************************************************************************
+ *
+ * Only compiled when HOST_BUILD is defined. lcd.h includes this header
+ * instead of stm32f1xx_hal.h so lcd.c can be built and exercised off-target.
+ *
+ * DMA:
+ * - HAL_DMA_Start_IT() only latches the transfer, nothing moves yet
+ * - LCD_Host_DMA_Complete() retires the latched transfer into the controller
+ *   model (lcd_emu.h) and runs the completion callback, the way
+ *   DMA2_Channel1_IRQHandler would on the MCU
+ * - Every retired transfer is appended to LCD_Host_DMA_Log[] so the run
+ *   scheduling and completion order can be checked
+ *
+ ******************************************************************************
+ */
+
+#ifndef __LCD_HOST_H
+#define __LCD_HOST_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define __ALIGN_BEGIN
+#define __ALIGN_END    __attribute__ ((aligned (4)))
+
+typedef enum {
+  HAL_OK       = 0x00,
+  HAL_ERROR    = 0x01,
+  HAL_BUSY     = 0x02,
+  HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+// DMA ------------------------------------------------------------------------
+#define DMA_MEMORY_TO_MEMORY    0x00004000U
+#define DMA_PINC_ENABLE         0x00000040U
+#define DMA_MINC_DISABLE        0x00000000U
+#define DMA_PDATAALIGN_BYTE     0x00000000U
+#define DMA_MDATAALIGN_BYTE     0x00000000U
+#define DMA_NORMAL              0x00000000U
+#define DMA_PRIORITY_LOW        0x00000000U
+
+typedef struct {
+  uint32_t Direction;
+  uint32_t PeriphInc;
+  uint32_t MemInc;
+  uint32_t PeriphDataAlignment;
+  uint32_t MemDataAlignment;
+  uint32_t Mode;
+  uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+  void *Instance;
+  DMA_InitTypeDef Init;
+  void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+  void (*XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+#define DMA2_Channel1           ((void *)0)
+#define DMA2_Channel1_IRQn      0
+#define __HAL_RCC_DMA2_CLK_ENABLE()            do { } while (0)
+#define HAL_NVIC_SetPriority(irq, pre, sub)     do { } while (0)
+#define HAL_NVIC_EnableIRQ(irq)                 do { } while (0)
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uintptr_t SrcAddress, uintptr_t DstAddress, uint32_t DataLength);
+
+// Checks ---------------------------------------------------------------------
+// Always on here (USE_FULL_ASSERT on the MCU), so the host checks trip them
+#define assert_param(expr)      assert(expr)
+
+// Clock ----------------------------------------------------------------------
+extern uint32_t SystemCoreClock;
+void HAL_Delay(uint32_t Delay);                 // Returns immediately
+
+// Host-side control of the DMA stand-in --------------------------------------
+#define LCD_HOST_DMA_LOG_SIZE   1024
+
+typedef struct {
+  const unsigned char *src;     // First byte of the run (inside backBuffer)
+  unsigned short length;        // Bytes transferred
+  uintptr_t dst;                // Destination (LCD_DATA_ADDR)
+} LCD_HostDMATransfer;
+
+extern LCD_HostDMATransfer LCD_Host_DMA_Log[LCD_HOST_DMA_LOG_SIZE];
+extern unsigned int LCD_Host_DMA_LogCount;
+
+unsigned char LCD_Host_DMA_Busy(void);      // 1 while a transfer is latched
+void LCD_Host_DMA_Complete(void);           // Retire it and fire the callback
+void LCD_Host_DMA_ResetLog(void);
+
+#endif /* __LCD_HOST_H */
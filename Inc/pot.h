@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * @file    pot.h
+ * @brief   Lives-selection potentiometer: continuous ADC, DMA, watchdog
+ ******************************************************************************
+ *
+ * ADC1 converts the pot (PC4, channel 14) continuously with a long sample
+ * time; DMA1 channel 1 writes the results round a circular buffer with no
+ * interrupts, so reading the knob costs no CPU. The analog watchdog watches
+ * a window around the last accepted value and interrupts only when the
+ * input leaves it, i.e. when the knob has really moved:
+ *
+ *   while (!Input_TakePress()) {
+ *     if (Pot_Poll()) updateLivesLED(Pot_GetLives());
+ *     Idle_WaitEvent();
+ *   }
+ *
+ * Pot_Poll() then averages the whole buffer (POT_DMA_SAMPLES conversions,
+ * ~1-4 ms of signal) and maps it to a lives count with POT_HYSTERESIS
+ * counts of hysteresis at the bucket edges, so the LEDs no longer flicker
+ * when the knob rests on a boundary.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __POT_H
+#define __POT_H
+
+#include "stm32f1xx_hal.h"
+
+#define POT_DMA_SAMPLES       64    // Circular buffer length = oversampling factor
+#define POT_FULL_SCALE        4096  // 12-bit ADC
+#define POT_LIVES             4     // Buckets: 1-4 lives
+#define POT_BUCKET_WIDTH      (POT_FULL_SCALE / POT_LIVES)
+#define POT_HYSTERESIS        48    // Counts past a bucket edge before the bucket changes
+#define POT_WATCH_WINDOW      32    // Watchdog window half-width around the accepted value
+
+void Pot_Init(ADC_HandleTypeDef *hadc);         // After MX_ADC1_Init(); starts ADC + DMA
+unsigned char Pot_Poll(void);                   // 1 -- the lives bucket changed
+unsigned char Pot_GetLives(void);               // 1 - POT_LIVES
+uint32_t Pot_GetFiltered(void);                 // Oversampled value, 0 - 4095
+uint16_t Pot_GetLatestSample(void);             // Newest raw conversion (noisy LSBs)
+unsigned long Pot_GetWatchdogEvents(void);
+
+void Pot_WatchdogIRQ(void);                     // From HAL_ADC_LevelOutOfWindowCallback
+
+#endif /* __POT_H */
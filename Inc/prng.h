@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * @file    prng.h
+ * @brief   Seeded pseudo-random streams and a seed entropy pool
+ ******************************************************************************
+ *
+ * STREAMS:
+ * --------
+ * Each PrngStream is an independent xorshift32 generator. Prng_Seed() derives
+ * its state from a game seed and a stream number, so one seed gives the same
+ * spawn timing and obstacle types on every build, and drawing more numbers
+ * from one stream never shifts another. Prng_Range() maps to [0, n) without
+ * modulo bias (Lemire's multiply-and-reject).
+ *
+ * SEEDING:
+ * --------
+ * Prng_EntropyAdd() folds noisy samples into a pool: ADC LSBs, cycle counter
+ * values at interrupts and button edges, SysTick phase. Prng_GameSeed()
+ * turns the pool into a seed - or returns the fixed seed when deterministic
+ * mode is on (Prng_SetFixedSeed(), or build with -DPRNG_FIXED_SEED=<seed>),
+ * which is what makes benchmark and replay runs comparable.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PRNG_H
+#define __PRNG_H
+
+#ifdef HOST_BUILD
+#include <stdint.h>
+#else
+#include "stm32f1xx_hal.h"
+#endif
+
+// Stream numbers
+#define PRNG_STREAM_SPAWN     0   // Frames between obstacle spawns
+#define PRNG_STREAM_TYPE      1   // Obstacle type
+
+typedef struct {
+  uint32_t state;             // Never 0
+} PrngStream;
+
+void Prng_Seed(PrngStream *stream, uint32_t seed, uint32_t streamId);
+uint32_t Prng_Next(PrngStream *stream);                 // Full 32 bits
+uint32_t Prng_Range(PrngStream *stream, uint32_t n);    // Unbiased, 0 - n-1 (0 when n == 0)
+
+void Prng_EntropyAdd(uint32_t sample);
+uint32_t Prng_GameSeed(void);                           // Fixed seed, or one drawn from the pool
+void Prng_SetFixedSeed(uint32_t seed);                  // Deterministic mode on
+void Prng_ClearFixedSeed(void);                         // Back to entropy seeds
+uint32_t Prng_GetLastSeed(void);                        // Seed the last Prng_GameSeed() returned
+
+#endif /* __PRNG_H */
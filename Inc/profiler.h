@@ -0,0 +1,77 @@
+/**
+ ******************************************************************************
+ * @file    profiler.h
+ * @brief   Frame-phase profiler for the main loop (DWT cycle counter)
+ ******************************************************************************
+ *
+ * USAGE:
+ * ------
+ *   Prof_Init();                    // once, after SystemClock_Config()
+ *   while (1) {
+ *     Prof_BeginFrame();            // closes and records the previous frame
+ *     readButton();     Prof_Mark(PROF_INPUT);
+ *     handleJump(&g);   Prof_Mark(PROF_JUMP);
+ *     ...
+ *     while (!flag) {}  Prof_Mark(PROF_IDLE);
+ *   }
+ *
+ * Prof_Mark(phase) charges the ticks since the previous mark (or the frame
+ * start) to that phase; several marks of one phase in a frame add up. Per
+ * phase the profiler keeps min/avg/max of the per-frame totals and a
+ * power-of-two histogram for percentiles. PROF_IDLE is the time spent
+ * waiting for the frame timer, so idle / frame is the headroom left.
+ *
+ * Ticks are CPU cycles (DWT CYCCNT) on the MCU and nanoseconds
+ * (CLOCK_MONOTONIC) on the host build.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#ifdef HOST_BUILD
+#include <stdint.h>
+#else
+#include "stm32f1xx_hal.h"
+#endif
+
+// Main loop phases
+#define PROF_INPUT        0   // Button read
+#define PROF_DRAW         1   // Dino clear/redraw
+#define PROF_JUMP         2   // handleJump
+#define PROF_ANIM         3   // updateDinoAnimation
+#define PROF_SPAWN        4   // Obstacle spawn
+#define PROF_OBSTACLES    5   // Obstacle move/draw
+#define PROF_COLLISION    6   // Collision checks
+#define PROF_LEDS         7   // updateLivesLED
+#define PROF_SPEED        8   // updateGameSpeed
+#define PROF_SWAP         9   // LCD_SwapBuffers
+#define PROF_IDLE         10  // Waiting on gameTimerFlag
+#define PROF_FRAME        11  // Whole frame, BeginFrame to BeginFrame
+#define PROF_PHASES       12
+
+#define PROF_BUCKETS      24  // Power-of-two tick buckets: 0, 1, 2-3, ... 2^22+
+
+typedef struct {
+  uint32_t count;             // Frames recorded
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t hist[PROF_BUCKETS];
+} ProfStats;
+
+void Prof_Init(void);
+uint32_t Prof_Now(void);                        // Current tick count
+uint32_t Prof_TicksPerUs(void);
+void Prof_BeginFrame(void);
+void Prof_Mark(unsigned char phase);
+void Prof_AbortFrame(void);                     // Drop the open frame (e.g. leaving the game loop)
+void Prof_Reset(void);
+
+void Prof_GetStats(unsigned char phase, ProfStats *stats);
+uint32_t Prof_Percentile(unsigned char phase, unsigned char percent);  // Bucket upper bound
+uint32_t Prof_IdlePermille(void);               // Idle ticks per 1000 frame ticks
+void Prof_Dump(void (*write)(const char *text, unsigned int length));
+
+#endif /* __PROFILER_H */
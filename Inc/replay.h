@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * @file    replay.h
+ * @brief   Game session recording and tick-exact playback
+ ******************************************************************************
+ *
+ * A game is fully decided by its seed, the lives chosen on the pot and the
+ * GAME_INPUT_* bits of every tick (see game_core.h), so that is all a
+ * Replay stores. The input bits are run-length encoded - the button changes
+ * a few times a second, not every tick - as 16-bit runs: the input in the
+ * top two bits, the tick count (1 - REPLAY_RUN_MAX) below. REPLAY_MAX_RUNS
+ * runs cover several minutes of play; a longer game keeps the first part.
+ *
+ * TEXT FORMAT (Replay_Dump / Replay_ParseChar):
+ * ---------------------------------------------
+ *   RPLY <REPLAY_VERSION, 1 hex> <seed, 8 hex> <lives, 2 hex>
+ *   <run, 4 hex> <run> ...            (16 per line)
+ *   END <ticks, 8 hex> <score, 8 hex>
+ *
+ * Tokens are separated by any whitespace, so the USART capture can be
+ * pasted back as it is. The END line is the score after the last recorded
+ * tick; Replay_Check() compares a playback against it. A capture with any
+ * other version than REPLAY_VERSION is rejected: it was recorded by a game
+ * that plays differently, so it would not replay the same.
+ *
+ * PLAYBACK:
+ * ---------
+ *   Replay_Rewind(&cursor, &replay);
+ *   GameCore_Init(&core, replay.seed, replay.lives);
+ *   while (Replay_NextInput(&cursor, &input)) GameCore_Step(&core, input, &io);
+ *   ok = Replay_Check(&replay, core.tickCount, core.state.score);
+ *
+ * or Replay_Run() for the whole loop. A capture from the board replays on
+ * Linux (Host/replay_run) through the same GameCore_Step, headless or into
+ * the LCD model.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __REPLAY_H
+#define __REPLAY_H
+
+#include "game_core.h"
+
+#define REPLAY_MAX_RUNS       1024    // 2 KB of runs
+#define REPLAY_RUN_BITS       14      // Frame count bits of a run
+#define REPLAY_RUN_MAX        ((1u << REPLAY_RUN_BITS) - 1)
+// Text format version, raised whenever the same input stops giving the same game:
+// 1 -- runs count frames, at a frame rate that rose with the game speed
+// 2 -- fixed simulation ticks (SIM_TICK_PERIOD), speed in the world instead
+// 3 -- Q8.8 jump and obstacle physics, pixel-rectangle collisions
+#define REPLAY_VERSION        3
+
+// Replay_ParseChar() results
+#define REPLAY_PARSE_MORE     0
+#define REPLAY_PARSE_DONE     1
+#define REPLAY_PARSE_ERROR    2
+
+typedef struct {
+  uint32_t seed;
+  unsigned char lives;
+  unsigned char truncated;    // Ran out of runs; the ticks before are kept
+  uint16_t runCount;
+  uint32_t ticks;             // Ticks recorded
+  uint32_t score;             // Score after the last recorded tick
+  uint16_t runs[REPLAY_MAX_RUNS];
+} Replay;
+
+typedef struct {
+  const Replay *replay;
+  uint16_t run;               // Run being played
+  uint16_t used;              // Ticks of it already played
+} ReplayCursor;
+
+typedef struct {
+  Replay *replay;
+  unsigned char state;
+  unsigned char length;
+  char token[10];
+} ReplayParser;
+
+// Recording
+void Replay_Begin(Replay *replay, uint32_t seed, unsigned char lives);
+void Replay_Record(Replay *replay, unsigned char input, uint32_t score);  // After each GameCore_Step()
+
+// Playback
+void Replay_Rewind(ReplayCursor *cursor, const Replay *replay);
+unsigned char Replay_NextInput(ReplayCursor *cursor, unsigned char *input);  // 0 -- no ticks left
+unsigned char Replay_AtEnd(const ReplayCursor *cursor);
+unsigned char Replay_Check(const Replay *replay, uint32_t ticks, uint32_t score);  // 1 -- same result
+unsigned char Replay_Run(const Replay *replay, GameCore *core, const GameIO *io);   // 1 -- same result
+
+// Text form
+void Replay_Dump(const Replay *replay, void (*write)(const char *text, unsigned int length));
+void Replay_ParserInit(ReplayParser *parser, Replay *replay);
+unsigned char Replay_ParseChar(ReplayParser *parser, char c);
+unsigned char Replay_ParseEnd(ReplayParser *parser);  // Input over; clears a half-read replay
+
+#endif /* __REPLAY_H */
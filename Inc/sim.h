@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * @file    sim.h
+ * @brief   Fixed-timestep simulation clock and render pacing
+ ******************************************************************************
+ *
+ * TIM1 interrupts every SIM_TICK_PERIOD and never changes rate; the game
+ * gets faster through its world speed (function.h) instead. The main loop
+ * sleeps until a tick is due, runs GameCore_Step() once for every tick that
+ * has come due since (an accumulator, so a slow frame does not slow the
+ * game down), and redraws only if the LCD has finished sending the previous
+ * frame:
+ *
+ *   Idle_WaitFlag(&gameTimerFlag);
+ *   n = Sim_TakeTicks();
+ *   while (n--) GameCore_Step(&core, input, &io);
+ *   if (LCD_GetFlushStatus() == LCD_FLUSH_IDLE) LCD_SwapBuffers(), Sim_CountRender(1);
+ *   else Sim_CountRender(0);
+ *
+ * A skipped render loses nothing: the ticks keep drawing into the back
+ * buffer and the next swap sends the difference, so rendering runs at
+ * whatever rate the bus allows without taking time from the simulation.
+ * More than SIM_MAX_CATCHUP ticks at once (a blocking UART dump, a halted
+ * debugger) are dropped rather than run, so the game pauses instead of
+ * fast-forwarding.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __SIM_H
+#define __SIM_H
+
+#include "stm32f1xx_hal.h"
+
+#define SIM_TICK_PERIOD       150   // TIM1 counts (10 kHz): 15 ms per tick, 66.7 Hz
+#define SIM_MAX_CATCHUP       8     // Most ticks run between two renders
+
+typedef struct {
+  uint32_t ticks;               // Ticks run
+  uint32_t ticksDropped;        // Ticks beyond SIM_MAX_CATCHUP, not run
+  uint32_t renders;             // Frames sent to the LCD
+  uint32_t rendersSkipped;      // Frames skipped, LCD still busy
+  uint32_t maxBatch;            // Most ticks run between two renders
+} SimStats;
+
+void Sim_TickIRQ(void);                                 // From the TIM1 update interrupt
+void Sim_Reset(void);                                   // Forget ticks due (e.g. after a menu)
+uint32_t Sim_TakeTicks(void);                           // Ticks due since the last call
+void Sim_CountRender(unsigned char rendered);           // 1 -- swapped, 0 -- skipped
+void Sim_GetStats(SimStats *stats);
+void Sim_Dump(void (*write)(const char *text, unsigned int length));
+
+#endif /* __SIM_H */
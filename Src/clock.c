@@ -0,0 +1,267 @@
+/**
+ ******************************************************************************
+ * @file    clock.c
+ * @brief   System clock profiles (oscillator, PLL, flash wait states, buses)
+ ******************************************************************************
+ *
+ * See clock.h. Clock_Config() runs once from SystemClock_Config(), before
+ * any peripheral is initialised; Clock_Switch() after that.
+ *
+ ******************************************************************************
+ */
+
+#include "clock.h"
+#include "fmt.h"
+#include "profiler.h"
+
+typedef struct {
+  uint32_t sysclkHz;
+  uint32_t oscillator;          // RCC_OSCILLATORTYPE_HSI / _HSE
+  uint32_t pllState;            // RCC_PLL_OFF / RCC_PLL_ON
+  uint32_t pllSource;
+  uint32_t pllMul;
+  uint32_t flashLatency;
+} ClockProfile;
+
+static const ClockProfile clockProfiles[CLOCK_PROFILES] = {
+  {  8000000, RCC_OSCILLATORTYPE_HSI, RCC_PLL_OFF,  RCC_PLLSOURCE_HSI_DIV2, RCC_PLL_MUL2,  FLASH_LATENCY_0 },
+  { 36000000, RCC_OSCILLATORTYPE_HSI, RCC_PLL_ON,   RCC_PLLSOURCE_HSI_DIV2, RCC_PLL_MUL9,  FLASH_LATENCY_1 },
+  { 64000000, RCC_OSCILLATORTYPE_HSI, RCC_PLL_ON,   RCC_PLLSOURCE_HSI_DIV2, RCC_PLL_MUL16, FLASH_LATENCY_2 },
+  { 72000000, RCC_OSCILLATORTYPE_HSE, RCC_PLL_ON,   RCC_PLLSOURCE_HSE,      RCC_PLL_MUL9,  FLASH_LATENCY_2 },
+};
+
+static unsigned char clockProfile = CLOCK_HSI_8MHZ;    // Reset state
+static void (*clockChangeCallback)(void) = 0;
+static uint32_t clockLastSwitchUs = 0;
+static uint32_t clockMaxSwitchUs = 0;
+static uint32_t clockLapTick;                           // Switch timing, see Clock_Lap
+static uint32_t clockLapHz;
+static uint32_t clockLapNs;
+
+/*******************************************************************************
+* Function Name  : Clock_StartOscillator
+* Description    : Start the profile's oscillator and PLL
+* Return         : HAL_OK, or the HAL error (e.g. HSE did not start)
+*******************************************************************************/
+static HAL_StatusTypeDef Clock_StartOscillator(const ClockProfile *p)
+{
+  RCC_OscInitTypeDef osc;
+
+  // HSE is always named so the non-crystal profiles switch it off again
+  osc.OscillatorType = RCC_OSCILLATORTYPE_HSI | RCC_OSCILLATORTYPE_HSE;
+  osc.HSEState = (p->oscillator == RCC_OSCILLATORTYPE_HSE) ? RCC_HSE_ON : RCC_HSE_OFF;
+  osc.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
+  osc.HSIState = RCC_HSI_ON;
+  osc.HSICalibrationValue = 16;
+  osc.PLL.PLLState = p->pllState;
+  osc.PLL.PLLSource = p->pllSource;
+  osc.PLL.PLLMUL = p->pllMul;
+  return HAL_RCC_OscConfig(&osc);
+}
+
+/*******************************************************************************
+* Function Name  : Clock_AdcPrescaler
+* Description    : Smallest ADC prescaler that keeps the ADC clock in spec
+*******************************************************************************/
+static uint32_t Clock_AdcPrescaler(uint32_t pclk2Hz)
+{
+  if (pclk2Hz / 2 <= CLOCK_ADC_MAX_HZ) return RCC_ADCPCLK2_DIV2;
+  if (pclk2Hz / 4 <= CLOCK_ADC_MAX_HZ) return RCC_ADCPCLK2_DIV4;
+  if (pclk2Hz / 6 <= CLOCK_ADC_MAX_HZ) return RCC_ADCPCLK2_DIV6;
+  return RCC_ADCPCLK2_DIV8;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_Config
+* Description    : Switch SYSCLK to a profile and set up everything that hangs
+*                  off it (wait states, bus prescalers, ADC clock, SysTick).
+*                  HAL_RCC_ClockConfig() raises the flash latency before and
+*                  lowers it after the switch, so both directions are safe.
+* Input          : profile -- CLOCK_HSI_8MHZ ... CLOCK_HSE_PLL_72MHZ
+* Output         : None
+* Return         : The profile now running: CLOCK_HSI_PLL_64MHZ when the HSE
+*                  profile was asked for but the crystal did not start
+*******************************************************************************/
+unsigned char Clock_Config(unsigned char profile)
+{
+  RCC_ClkInitTypeDef clk;
+  RCC_PeriphCLKInitTypeDef periph;
+  const ClockProfile *p;
+
+  if (profile >= CLOCK_PROFILES) profile = CLOCK_PROFILE_DEFAULT;
+  p = &clockProfiles[profile];
+
+  if (Clock_StartOscillator(p) != HAL_OK) {
+    if (p->oscillator != RCC_OSCILLATORTYPE_HSE) return clockProfile;
+    profile = CLOCK_HSI_PLL_64MHZ;
+    p = &clockProfiles[profile];
+    if (Clock_StartOscillator(p) != HAL_OK) return clockProfile;
+  }
+
+  clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK
+                | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+  if (p->pllState == RCC_PLL_ON) {
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  } else {
+    clk.SYSCLKSource = (p->oscillator == RCC_OSCILLATORTYPE_HSE) ? RCC_SYSCLKSOURCE_HSE : RCC_SYSCLKSOURCE_HSI;
+  }
+  clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  clk.APB1CLKDivider = (p->sysclkHz > 36000000) ? RCC_HCLK_DIV2 : RCC_HCLK_DIV1;
+  clk.APB2CLKDivider = RCC_HCLK_DIV1;   // Keeps TIM1CLK = PCLK2 (see Clock_Tim1Prescaler)
+  if (HAL_RCC_ClockConfig(&clk, p->flashLatency) != HAL_OK) return clockProfile;
+
+  // With wait states the prefetch buffer keeps sequential fetches at 0 WS
+  __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+
+  periph.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+  periph.AdcClockSelection = Clock_AdcPrescaler(HAL_RCC_GetPCLK2Freq());
+  HAL_RCCEx_PeriphCLKConfig(&periph);
+
+  HAL_SYSTICK_Config(HAL_RCC_GetHCLKFreq()/1000);
+  HAL_SYSTICK_CLKSourceConfig(SYSTICK_CLKSOURCE_HCLK);
+  /* SysTick_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(SysTick_IRQn, 0, 0);
+
+  clockProfile = profile;
+  return profile;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_GetProfile
+* Description    : Profile set by the last successful Clock_Config()
+* Input          : None
+* Output         : None
+* Return         : CLOCK_* profile
+*******************************************************************************/
+unsigned char Clock_GetProfile(void)
+{
+  return clockProfile;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_Tim1Prescaler
+* Description    : TIM1 prescaler for a CLOCK_TIM1_TICK_HZ counter. APB2 is
+*                  never divided here, so TIM1CLK = PCLK2 (no x2).
+* Input          : None
+* Output         : None
+* Return         : Value for TIM_Base_InitTypeDef.Prescaler (799 at 8 MHz,
+*                  7199 at 72 MHz)
+*******************************************************************************/
+uint32_t Clock_Tim1Prescaler(void)
+{
+  return HAL_RCC_GetPCLK2Freq() / CLOCK_TIM1_TICK_HZ - 1;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_Lap
+* Description    : Add the cycles since the previous lap to the switch time.
+*                  CYCCNT counts at whatever SYSCLK is, so each stretch is
+*                  converted at the slower of the clocks it may have run at;
+*                  the total is an upper bound.
+*******************************************************************************/
+static void Clock_Lap(void)
+{
+  uint32_t now = Prof_Now();
+  uint32_t hz = SystemCoreClock;
+
+  if (clockLapHz < hz) hz = clockLapHz;
+  clockLapNs += (uint32_t)((uint64_t)(now - clockLapTick) * 1000000000ULL / hz);
+  clockLapTick = now;
+  clockLapHz = SystemCoreClock;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_Switch
+* Description    : Change the clock profile while running. The PLL cannot be
+*                  reprogrammed while it drives SYSCLK, so a PLL profile first
+*                  drops to the HSI, then Clock_Config() brings up the new one.
+*                  Peripherals clocked from a bus keep running; anything that
+*                  depends on the bus frequency is re-derived by the change
+*                  callback. Call between frames with the LCD flush drained.
+* Input          : profile -- CLOCK_HSI_8MHZ ... CLOCK_HSE_PLL_72MHZ
+* Output         : None
+* Return         : The profile now running (see Clock_Config)
+*******************************************************************************/
+unsigned char Clock_Switch(unsigned char profile)
+{
+  RCC_ClkInitTypeDef clk;
+
+  if (profile == clockProfile) return clockProfile;
+
+  clockLapTick = Prof_Now();
+  clockLapHz = SystemCoreClock;
+  clockLapNs = 0;
+
+  if (clockProfiles[clockProfile].pllState == RCC_PLL_ON) {
+    clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK
+                  | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+    clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+    // Keep the wait states; Clock_Config() sets the final ones
+    if (HAL_RCC_ClockConfig(&clk, clockProfiles[clockProfile].flashLatency) != HAL_OK) return clockProfile;
+    clockProfile = CLOCK_HSI_8MHZ;    // What runs now, should the next step fail
+    Clock_Lap();
+  }
+
+  Clock_Config(profile);
+  Clock_Lap();
+  if (clockChangeCallback) clockChangeCallback();
+  Clock_Lap();
+
+  clockLastSwitchUs = clockLapNs / 1000;
+  if (clockLastSwitchUs > clockMaxSwitchUs) clockMaxSwitchUs = clockLastSwitchUs;
+  return clockProfile;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_SetChangeCallback
+* Description    : Hook run after each Clock_Switch() to re-derive dividers
+*                  that live outside this module
+* Input          : callback -- function to call, or 0 for none
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Clock_SetChangeCallback(void (*callback)(void))
+{
+  clockChangeCallback = callback;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_GetLastSwitchUs / Clock_GetMaxSwitchUs
+* Description    : Duration of the last / longest Clock_Switch(), callback
+*                  included
+*******************************************************************************/
+uint32_t Clock_GetLastSwitchUs(void)
+{
+  return clockLastSwitchUs;
+}
+
+uint32_t Clock_GetMaxSwitchUs(void)
+{
+  return clockMaxSwitchUs;
+}
+
+/*******************************************************************************
+* Function Name  : Clock_Dump
+* Description    : Write the clock state as one line of text:
+*                    clock sysclk=8000000 switch last=412us max=1630us
+* Input          : write -- called once per line (e.g. a UART transmit)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Clock_Dump(void (*write)(const char *text, unsigned int length))
+{
+  char line[64];
+  unsigned int pos;
+
+  pos = Fmt_AppendText(line, 0, "clock sysclk=");
+  pos = Fmt_AppendUInt(line, pos, SystemCoreClock);
+  pos = Fmt_AppendText(line, pos, " switch last=");
+  pos = Fmt_AppendUInt(line, pos, clockLastSwitchUs);
+  pos = Fmt_AppendText(line, pos, "us max=");
+  pos = Fmt_AppendUInt(line, pos, clockMaxSwitchUs);
+  pos = Fmt_AppendText(line, pos, "us\r\n");
+  write(line, pos);
+}
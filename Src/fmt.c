@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file    fmt.c
+ * @brief   Minimal text formatting for the UART dumps (no printf)
+ ******************************************************************************
+ *
+ * See fmt.h. Decimal digits come out least significant first, so they go
+ * through a 10-byte stack buffer and are copied out in reverse.
+ *
+ ******************************************************************************
+ */
+
+#include "fmt.h"
+
+/*******************************************************************************
+* Function Name  : Fmt_AppendText
+* Description    : Append a string, without its terminator
+* Input          : buf -- text buffer, pos -- write position
+*                  text -- zero-terminated string
+* Output         : None
+* Return         : New write position
+*******************************************************************************/
+unsigned int Fmt_AppendText(char *buf, unsigned int pos, const char *text)
+{
+  while (*text) {
+    buf[pos++] = *text++;
+  }
+  return pos;
+}
+
+/*******************************************************************************
+* Function Name  : Fmt_AppendUInt
+* Description    : Append a number in decimal, without leading zeros
+* Input          : buf -- text buffer, pos -- write position
+*                  value -- number to append
+* Output         : None
+* Return         : New write position
+*******************************************************************************/
+unsigned int Fmt_AppendUInt(char *buf, unsigned int pos, uint32_t value)
+{
+  char digits[10];
+  unsigned char n = 0;
+
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value && n < sizeof(digits));
+  while (n) {
+    buf[pos++] = digits[--n];
+  }
+  return pos;
+}
+
+/*******************************************************************************
+* Function Name  : Fmt_AppendHex
+* Description    : Append the low digits of a number in upper case hex,
+*                  zero padded to exactly that many digits
+* Input          : buf -- text buffer, pos -- write position
+*                  value -- number to append, digits -- 1-8
+* Output         : None
+* Return         : New write position
+*******************************************************************************/
+unsigned int Fmt_AppendHex(char *buf, unsigned int pos, uint32_t value, unsigned char digits)
+{
+  static const char hex[] = "0123456789ABCDEF";
+
+  while (digits--) {
+    buf[pos++] = hex[(value >> (digits * 4)) & 0xF];
+  }
+  return pos;
+}
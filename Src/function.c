@@ -32,17 +32,18 @@
  *   DinoGameState gameState;
  *   initGameState(&gameState);
  *   
- *   // Draw initial ground
+ *   // Draw initial ground; sprites erase back to it
  *   drawGroundLine(0);
+ *   LCD_Background_Capture();
  *   
  *   // Game loop
  *   while(1) {
  *       // Clear old dino position
- *       clearSprite(gameState.dinoX, gameState.dinoY, 2);
+ *       clearSprite(Q8_INT(gameState.dinoRow), gameState.dinoY, 2);
  *       
  *       // Handle jump (trigger with button press)
- *       if (buttonPressed && !gameState.isJumping && gameState.jumpHeight == 0) {
- *           gameState.isJumping = 1;
+ *       if (buttonPressed && isOnGround(&gameState)) {
+ *           startJump(&gameState);
  *       }
  *       handleJump(&gameState);
  *       
@@ -52,11 +53,11 @@
  *       // Draw dino at new position
  *       drawDino(&gameState);
  *       
- *       // Update and draw obstacles
- *       // (create Obstacle structs and call updateObstacle)
+ *       // Spawn, move and collide obstacles: GameCore_Step() in
+ *       // game_core.c does this (and the rest of the tick) for the board
  *       
- *       // Delay for game speed
- *       HAL_Delay(gameState.gameSpeed);
+ *       // Wait for the next simulation tick (sim.h)
+ *       Idle_WaitFlag(&gameTimerFlag);
  *       
  *       // Increment score
  *       gameState.score++;
@@ -72,52 +73,64 @@
 
 // Initialize game state
 void initGameState(DinoGameState *state) {
-    state->dinoX = GROUND_PAGE - 2; // Start 2 page above ground (page 5)
+    state->dinoRow = Q8(DINO_GROUND_ROW);  // On the ground (page 5)
+    state->dinoVel = 0;
     state->dinoY = 8;  // Leftmost position
     state->dinoState = 0;  // Running
     state->animFrame = 0;
-    state->jumpHeight = 0;
     state->isJumping = 0;
     state->jumpHangCounter = 0;
     state->buttonHeld = 0;  // Button not held initially
     state->lives = 1;  // Default 1 life
     state->score = 0;
-    state->currentSpeed = OBSTACLE_SPEED_INIT;  // Start with initial speed
+    state->worldSpeed = WORLD_SPEED_INIT;  // Start with initial speed
     state->speedTimer = 0;  // Reset speed timer
     state->animTimer = 0;   // Reset animation timer
-    state->physicsTimer = 0; // Reset physics timer
 }
 
-// Draw the dino at current state position (uses frame buffer)
-void drawDino(DinoGameState *state) {
-    unsigned char sprite[2];  // Array for 16x16 sprite (2 chars wide)
-    
-    // Select sprite based on state
-    // 16x16 sprites use 2 consecutive indices (e.g., 125 and 126)
+// First glyph of the dino sprite for the current state
+// 16x16 sprites use 2 consecutive indices (e.g., 125 and 126)
+static unsigned char dinoSprite(DinoGameState *state) {
     if (state->isJumping) {
-        sprite[0] = SPRITE_DINO_STAND;      // Index 125
-        sprite[1] = SPRITE_DINO_STAND + 1;  // Index 126
-    } else {
-        // Alternate between run frames for running animation
-        if (state->animFrame % 8 < 4) {
-            sprite[0] = SPRITE_DINO_RUN;      // Index 127
-            sprite[1] = SPRITE_DINO_RUN + 1;  // Index 128
-        } else {
-            sprite[0] = SPRITE_DINO_RUN_2;      // Index 133
-            sprite[1] = SPRITE_DINO_RUN_2 + 1;  // Index 134
-        }
+        return SPRITE_DINO_STAND;      // Index 125-126
     }
+    // Alternate between run frames for running animation
+    if (state->animFrame % 8 < 4) {
+        return SPRITE_DINO_RUN;        // Index 127-128
+    }
+    return SPRITE_DINO_RUN_2;          // Index 129-130
+}
+
+// Draw the dino at current state position (uses frame buffer)
+void drawDino(DinoGameState *state) {
+    // Draw the dino to frame buffer (16x16 sprite using 2 consecutive 8x16
+    // chars) at its pixel row
+    LCD_Buffer_DrawSprite(Q8_INT(state->dinoRow), state->dinoY, dinoSprite(state), 2);
+}
+
+// Erase the dino drawn at fromRow and draw it at its current row in one
+// pass; bytes that come out the same are not written
+void moveDino(DinoGameState *state, unsigned char fromRow) {
+    LCD_Sprite sprite;
+    LCD_SpritePos from, to;
     
-    // Draw the dino to frame buffer (16x16 sprite using 2 consecutive 8x16 chars)
-    LCD_Buffer_DrawString(state->dinoX, state->dinoY, sprite, 2);
+    sprite.offset = dinoSprite(state);
+    sprite.width = 2;
+    from.row = fromRow;
+    from.col = state->dinoY;
+    to.row = Q8_INT(state->dinoRow);
+    to.col = state->dinoY;
+    LCD_Buffer_MoveSprite(&from, &to, &sprite);
 }
 
-// Draw dead dino sprite at current position (uses frame buffer)
+// Outline mask of the dead dino (cacheSprites() fills it in)
+static unsigned char dinoDeadMask[32];
+
+// Draw dead dino sprite at current position (uses frame buffer). Copied
+// inside its outline, so it stays readable over the cactus it hit.
 void drawDinoDead(DinoGameState *state) {
-    unsigned char sprite[2];
-    sprite[0] = SPRITE_DINO_DEAD;      // Index 131
-    sprite[1] = SPRITE_DINO_DEAD + 1;  // Index 132
-    LCD_Buffer_DrawString(state->dinoX, state->dinoY, sprite, 2);
+    LCD_Buffer_BlitSprite(Q8_INT(state->dinoRow), state->dinoY, SPRITE_DINO_DEAD, 2,
+                          dinoDeadMask, LCD_ROP_COPY);  // Index 131-132
 }
 
 // Update dino animation frame
@@ -128,14 +141,34 @@ void updateDinoAnimation(DinoGameState *state) {
     }
 }
 
-// Handle jump mechanics with level-triggered hang time
-// Holding button longer at peak increases hang time (up to max)
+// On the ground and not taking off - a jump can start
+unsigned char isOnGround(DinoGameState *state) {
+    return !state->isJumping && state->dinoRow >= Q8(DINO_GROUND_ROW);
+}
+
+// Take off: upward velocity, gravity does the rest in handleJump()
+void startJump(DinoGameState *state) {
+    state->isJumping = 1;
+    state->dinoVel = -JUMP_VELOCITY;
+    state->jumpHangCounter = 0;
+}
+
+// Handle jump physics with level-triggered hang time - call every tick
+// Q8.8 position and velocity; gravity slows the rise, the dino hangs at the
+// apex (longer while the button is held), then gravity brings it down
 void handleJump(DinoGameState *state) {
     if (state->isJumping) {
-        // Going up
-        if (state->jumpHeight < JUMP_MAX_HEIGHT) {
-            state->jumpHeight++;
-            state->dinoX--;  // Move up one page
+        if (state->dinoVel < 0) {
+            // Going up
+            state->dinoRow += state->dinoVel;
+            state->dinoVel += JUMP_GRAVITY;
+            if (state->dinoVel >= 0 || state->dinoRow <= Q8(DINO_GROUND_ROW - JUMP_HEIGHT)) {
+                // Reached the apex
+                if (state->dinoRow < Q8(DINO_GROUND_ROW - JUMP_HEIGHT)) {
+                    state->dinoRow = Q8(DINO_GROUND_ROW - JUMP_HEIGHT);
+                }
+                state->dinoVel = 0;
+            }
         } else {
             // At peak - hang in the air
             state->jumpHangCounter++;
@@ -150,28 +183,76 @@ void handleJump(DinoGameState *state) {
                 state->jumpHangCounter = 0;
             }
         }
-    } else if (state->jumpHeight > 0) {
+    } else if (state->dinoRow < Q8(DINO_GROUND_ROW)) {
         // Coming down
-        state->jumpHeight--;
-        state->dinoX++;  // Move down one page
+        state->dinoVel += JUMP_GRAVITY;
+        state->dinoRow += state->dinoVel;
+        if (state->dinoRow >= Q8(DINO_GROUND_ROW)) {
+            state->dinoRow = Q8(DINO_GROUND_ROW);  // Landed
+            state->dinoVel = 0;
+        }
     }
 }
 
-// Draw a cactus obstacle (uses frame buffer)
-void drawCactus(unsigned char x, unsigned char y, unsigned char type) {
-    unsigned char sprite[2];
+// Pixel-rectangle collision between the dino (inset by DINO_HIT_INSET) and
+// an obstacle's sprite box (16 or 8 columns wide, 16 rows from its page)
+unsigned char obstacleHit(DinoGameState *state, Obstacle *obs) {
+    int dinoLeft = state->dinoY + DINO_HIT_INSET;
+    int dinoRight = state->dinoY + 15 - DINO_HIT_INSET;
+    int dinoTop = Q8_INT(state->dinoRow) + DINO_HIT_INSET;
+    int dinoBottom = Q8_INT(state->dinoRow) + 15 - DINO_HIT_INSET;
+    int obsLeft = obs->y;
+    int obsRight = obs->y + ((obs->type == 0) ? 15 : 7);
+    int obsTop = obs->x * 8;
+    int obsBottom = obsTop + 15;
+    
+    return dinoRight >= obsLeft && dinoLeft <= obsRight &&
+           dinoBottom >= obsTop && dinoTop <= obsBottom;
+}
+
+// Draw a cactus obstacle at page x (uses frame buffer, OR-ed like the dino).
+// Column y may be partly off either edge; only the visible part is drawn.
+void drawCactus(unsigned char x, signed short y, unsigned char type) {
     if (type == 0) {
         // Big cactus (16x16)
-        sprite[0] = SPRITE_CACTUS_BIG;
-        sprite[1] = SPRITE_CACTUS_BIG + 1;
-        LCD_Buffer_DrawString(x, y, sprite, 2);
+        LCD_Buffer_DrawSprite(x * 8, y, SPRITE_CACTUS_BIG, 2);
     } else {
         // Small cactus (8x16)
-        sprite[0] = SPRITE_CACTUS_SMALL;
-        LCD_Buffer_DrawString(x, y, sprite, 1);
+        LCD_Buffer_DrawSprite(x * 8, y, SPRITE_CACTUS_SMALL, 1);
     }
 }
 
+// Move a cactus on page x from column fromY to toY: erase and redraw in
+// one pass over the union of the two positions
+void moveCactus(unsigned char x, signed short fromY, signed short toY, unsigned char type) {
+    LCD_Sprite sprite;
+    LCD_SpritePos from, to;
+    
+    sprite.offset = (type == 0) ? SPRITE_CACTUS_BIG : SPRITE_CACTUS_SMALL;
+    sprite.width = (type == 0) ? 2 : 1;
+    from.row = x * 8;
+    from.col = fromY;
+    to.row = x * 8;
+    to.col = toY;
+    LCD_Buffer_MoveSprite(&from, &to, &sprite);
+}
+
+// Pre-shift the sprites drawn every tick (call once at startup)
+void cacheSprites(void) {
+    static const unsigned char hot[] = {
+        SPRITE_DINO_STAND, SPRITE_DINO_RUN, SPRITE_DINO_RUN_2, SPRITE_DINO_DEAD,
+        SPRITE_CACTUS_BIG
+    };
+    unsigned char i;
+    for (i = 0; i < sizeof(hot); i++) {
+        LCD_GlyphCache_Add(hot[i]);
+        LCD_GlyphCache_Add(hot[i] + 1);
+    }
+    LCD_GlyphCache_Add(SPRITE_CACTUS_SMALL);
+    LCD_MakeGlyphMask(SPRITE_DINO_DEAD, dinoDeadMask);
+    LCD_MakeGlyphMask(SPRITE_DINO_DEAD + 1, dinoDeadMask + 16);
+}
+
 // Draw a star decoration (uses frame buffer)
 void drawStar(unsigned char x, unsigned char y) {
     unsigned char sprite[2] = {SPRITE_STAR, SPRITE_STAR + 1};
@@ -194,31 +275,10 @@ void drawGroundLine(unsigned char y) {
     }
 }
 
-// Clear a sprite area in frame buffer
-void clearSprite(unsigned char x, unsigned char y, unsigned char width) {
-    // Clear area in frame buffer
-    LCD_Buffer_ClearArea(x, y, width);
-}
-
-// Update obstacle position (move left) - uses frame buffer
-void updateObstacle(Obstacle *obs) {
-    if (obs->active) {
-        if (obs->y > 0) {
-            // Clear old position in buffer
-            LCD_Buffer_ClearArea(obs->x, obs->y, 2);
-            
-            // Move left
-            obs->y -= 8;
-            
-            // Draw at new position in buffer
-            if (obs->type == 0 || obs->type == 1) {
-                drawCactus(obs->x, obs->y, obs->type);
-            }
-        } else {
-            // Obstacle has moved off screen
-            obs->active = 0;
-        }
-    }
+// Erase a sprite area in frame buffer back to the background scenery: 16
+// rows from a pixel row, width in 8-column chars (clipped at both edges)
+void clearSprite(unsigned char row, signed short col, unsigned char width) {
+    LCD_Buffer_RestoreRect(col, row, col + width * 8 - 1, row + 15);
 }
 
 // Draw score using number sprites (uses frame buffer)
@@ -275,6 +335,7 @@ void clearEndScreen(void) {
     LCD_Buffer_ClearArea(3, 52, 3);
 }
 
+#ifndef HOST_BUILD
 // Update LEDs to show number of lives (1-4)
 void updateLivesLED(unsigned char lives) {
     // LED1 = life 1, LED2 = life 2, etc.
@@ -284,11 +345,10 @@ void updateLivesLED(unsigned char lives) {
     HAL_GPIO_WritePin(LED2_GPIO_PORT, LED2_PIN, (lives >= 3) ? GPIO_PIN_SET : GPIO_PIN_RESET);
     HAL_GPIO_WritePin(LED1_GPIO_PORT, LED1_PIN, (lives >= 4) ? GPIO_PIN_SET : GPIO_PIN_RESET);
 }
+#endif
 
-// Update game speed using PWM - gradually increases pace over time
-// This function should be called every frame
-extern TIM_HandleTypeDef htim1;
-
+// Increase game difficulty over time - call every simulation tick
+// The world scrolls faster; the tick rate itself never changes
 void updateGameSpeed(DinoGameState *state) {
     state->speedTimer++;
     
@@ -296,20 +356,10 @@ void updateGameSpeed(DinoGameState *state) {
     if (state->speedTimer >= SPEED_INCREASE_RATE) {
         state->speedTimer = 0;
         
-        // Decrease obstacle speed (lower = faster movement)
-        if (state->currentSpeed > OBSTACLE_SPEED_MIN) {
-            state->currentSpeed--;
-        }
-        
-        // Also adjust PWM timer period for smoother overall game speed
-        // Get current period and decrease it
-        uint32_t currentPeriod = __HAL_TIM_GET_AUTORELOAD(&htim1);
-        if (currentPeriod > TIMER_PERIOD_MIN) {
-            uint32_t newPeriod = currentPeriod - TIMER_SPEED_STEP;
-            if (newPeriod < TIMER_PERIOD_MIN) {
-                newPeriod = TIMER_PERIOD_MIN;
-            }
-            __HAL_TIM_SET_AUTORELOAD(&htim1, newPeriod);
+        if (state->worldSpeed < WORLD_SPEED_MAX - WORLD_SPEED_STEP) {
+            state->worldSpeed += WORLD_SPEED_STEP;
+        } else {
+            state->worldSpeed = WORLD_SPEED_MAX;
         }
     }
 }
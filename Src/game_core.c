@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * @file    game_core.c
+ * @brief   Platform-free game step: one call advances the game one tick
+ ******************************************************************************
+ *
+ * See game_core.h. The tick is the old main loop body in the same order;
+ * only the side effects moved behind GameIO.
+ *
+ ******************************************************************************
+ */
+
+#include "game_core.h"
+#include "profiler.h"
+
+/*******************************************************************************
+* Function Name  : GameCore_Mark
+* Description    : Close a profiler phase, if the platform profiles
+*******************************************************************************/
+static void GameCore_Mark(const GameIO *io, unsigned char phase)
+{
+  if (io->mark) io->mark(phase);
+}
+
+/*******************************************************************************
+* Function Name  : GameCore_Clear
+* Description    : Clear a 16x16 sprite area, if the platform renders
+*******************************************************************************/
+static void GameCore_Clear(const GameIO *io, unsigned char row, signed short col)
+{
+  if (io->clearSprite) io->clearSprite(row, col, 2);
+}
+
+/*******************************************************************************
+* Function Name  : GameCore_Init
+* Description    : Start a game: fresh state, no obstacles, random streams
+*                  seeded, first obstacle GAME_FIRST_SPAWN frames away
+* Input          : core -- game to set, seed -- e.g. Prng_GameSeed(),
+*                  lives -- 1-4
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void GameCore_Init(GameCore *core, uint32_t seed, unsigned char lives)
+{
+  int i;
+
+  initGameState(&core->state);
+  core->state.lives = lives;
+  for (i = 0; i < MAX_OBSTACLES; i++) {
+    core->obstacles[i].active = 0;
+  }
+  Prng_Seed(&core->spawnRandom, seed, PRNG_STREAM_SPAWN);
+  Prng_Seed(&core->typeRandom, seed, PRNG_STREAM_TYPE);
+  core->tickCount = 0;
+  core->nextObstacleSpawn = GAME_FIRST_SPAWN;
+  core->over = 0;
+}
+
+/*******************************************************************************
+* Function Name  : GameCore_Step
+* Description    : Advance the game exactly one simulation tick
+* Input          : core -- game, input -- GAME_INPUT_* bits for this tick,
+*                  io -- side effects (members may be NULL)
+* Output         : None
+* Return         : GAME_STEP_RUNNING, or GAME_STEP_OVER once the last life
+*                  is lost (further steps do nothing)
+*******************************************************************************/
+unsigned char GameCore_Step(GameCore *core, unsigned char input, const GameIO *io)
+{
+  DinoGameState *game = &core->state;
+  Obstacle *obstacles = core->obstacles;
+  unsigned char dinoFromRow = Q8_INT(game->dinoRow);  // Where the dino is drawn
+  int i;
+
+  if (core->over) return GAME_STEP_OVER;
+
+  // A press since the last tick jumps even if already released; holding
+  // the button keeps jumping on landing
+  game->buttonHeld = (input & GAME_INPUT_BUTTON) ? 1 : 0;
+  if ((input & (GAME_INPUT_BUTTON | GAME_INPUT_PRESS)) && isOnGround(game)) {
+    startJump(game);
+  }
+  GameCore_Mark(io, PROF_INPUT);
+
+  // Fixed-point jump physics, every tick
+  handleJump(game);
+  GameCore_Mark(io, PROF_JUMP);
+
+  // Update animation at controlled rate
+  game->animTimer++;
+  if (game->animTimer >= DINO_ANIM_SPEED) {
+    game->animTimer = 0;
+    updateDinoAnimation(game);
+  }
+  GameCore_Mark(io, PROF_ANIM);
+
+  // Move the dino drawing from its old row to the new one
+  if (io->moveDino) io->moveDino(game, dinoFromRow);
+  GameCore_Mark(io, PROF_DRAW);
+
+  // Spawn obstacles with random spacing
+  core->tickCount++;
+  if (core->tickCount >= core->nextObstacleSpawn) {
+    for (i = 0; i < MAX_OBSTACLES; i++) {
+      if (!obstacles[i].active) {
+        obstacles[i].x = GROUND_PAGE - 2;  // 2 page above ground
+        obstacles[i].y = OBSTACLE_SPAWN_COL;  // Just off the right edge
+        obstacles[i].yQ8 = Q8(OBSTACLE_SPAWN_COL);
+        obstacles[i].type = (unsigned char)Prng_Range(&core->typeRandom, 2);  // 0=big, 1=small cactus
+        obstacles[i].active = 1;
+        // Uniform in [OBSTACLE_SPAWN_MIN, OBSTACLE_SPAWN_MAX]
+        core->nextObstacleSpawn = core->tickCount + OBSTACLE_SPAWN_MIN +
+            Prng_Range(&core->spawnRandom, OBSTACLE_SPAWN_MAX - OBSTACLE_SPAWN_MIN + 1);
+        break;
+      }
+    }
+  }
+  GameCore_Mark(io, PROF_SPAWN);
+
+  // Move obstacles left by the world speed (Q8.8 columns per tick). One is
+  // only redrawn when its whole-pixel column changes, clipped at the edges,
+  // so it slides in from the right and out on the left a pixel at a time;
+  // one that reaches OBSTACLE_EXIT_COL is gone and scores.
+  for (i = 0; i < MAX_OBSTACLES; i++) {
+    if (obstacles[i].active) {
+      if (obstacles[i].yQ8 >= Q8(OBSTACLE_EXIT_COL) + game->worldSpeed) {
+        int16_t col;
+        obstacles[i].yQ8 -= game->worldSpeed;
+        col = (int16_t)Q8_INT(obstacles[i].yQ8);
+        if (col != obstacles[i].y) {
+          if (io->moveCactus) io->moveCactus(obstacles[i].x, obstacles[i].y, col, obstacles[i].type);
+          obstacles[i].y = col;
+        }
+      } else {
+        GameCore_Clear(io, obstacles[i].x * 8, obstacles[i].y);
+        obstacles[i].active = 0;
+        game->score++;
+      }
+    }
+  }
+  GameCore_Mark(io, PROF_OBSTACLES);
+
+  // Collision detection (check every tick), pixel hitboxes
+  for (i = 0; i < MAX_OBSTACLES; i++) {
+    if (obstacles[i].active && obstacleHit(game, &obstacles[i])) {
+      // Collision! Lose a life; the obstacle that hit us goes
+      game->lives--;
+      if (io->setLives) io->setLives(game->lives);
+      obstacles[i].active = 0;
+      GameCore_Clear(io, obstacles[i].x * 8, obstacles[i].y);
+      if (game->lives == 0) {
+        core->over = 1;
+      }
+      break;
+    }
+  }
+  GameCore_Mark(io, PROF_COLLISION);
+
+  // Update lives display on LEDs
+  if (io->setLives) io->setLives(game->lives);
+  GameCore_Mark(io, PROF_LEDS);
+
+  // Increase difficulty over time (world speed)
+  updateGameSpeed(game);
+  GameCore_Mark(io, PROF_SPEED);
+
+  return core->over ? GAME_STEP_OVER : GAME_STEP_RUNNING;
+}
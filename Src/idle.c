@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file    idle.c
+ * @brief   Sleep-until-interrupt idle and CPU utilization counters
+ ******************************************************************************
+ *
+ * See idle.h. Sleep is plain Sleep mode (WFI, SLEEPDEEP clear): HCLK keeps
+ * running for the peripherals and FCLK for the debug block, so DWT CYCCNT
+ * counts through it and sleep time can be measured in the same ticks as the
+ * profiler. With HOST_BUILD there is nothing to sleep on; waits spin and all
+ * time counts as active.
+ *
+ ******************************************************************************
+ */
+
+#include "idle.h"
+#include "fmt.h"
+
+static uint64_t idleWallTicks;
+static uint64_t idleSleepTicks;
+static uint32_t idleFrames;
+static uint32_t idleLastUtil;
+static uint32_t idleMaxUtil;
+static uint32_t idleFrameStart;                 // Tick of the last Idle_EndFrame
+static uint32_t idleFrameSleep;                 // Sleep ticks in the open frame
+
+/*******************************************************************************
+* Function Name  : Idle_Sleep
+* Description    : Sleep until the next interrupt and charge the time to the
+*                  sleep counters. Must be entered with interrupts masked:
+*                  WFI still wakes on a pending interrupt while PRIMASK is set,
+*                  so an interrupt that arrives between the caller's check and
+*                  the WFI is not lost. The handler runs on __enable_irq().
+*******************************************************************************/
+static void Idle_Sleep(void)
+{
+#ifdef HOST_BUILD
+  __asm__ volatile ("" ::: "memory");
+#else
+  uint32_t t0 = Prof_Now();
+  uint32_t slept;
+
+  __WFI();
+  slept = Prof_Now() - t0;
+  __enable_irq();
+  idleSleepTicks += slept;
+  idleFrameSleep += slept;
+#endif
+}
+
+/*******************************************************************************
+* Function Name  : Idle_Init
+* Description    : Clear the counters and start the first frame. The profiler
+*                  must already be running (Prof_Init()).
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_Init(void)
+{
+  idleWallTicks = 0;
+  idleSleepTicks = 0;
+  idleFrames = 0;
+  idleLastUtil = 0;
+  idleMaxUtil = 0;
+  idleFrameSleep = 0;
+  idleFrameStart = Prof_Now();
+}
+
+/*******************************************************************************
+* Function Name  : Idle_WaitFlag
+* Description    : Sleep until an interrupt handler sets *flag. The flag is
+*                  checked with interrupts masked so a set between the check
+*                  and the WFI still wakes the core. Does not clear the flag.
+* Input          : flag -- set from an ISR (e.g. gameTimerFlag)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_WaitFlag(volatile unsigned char *flag)
+{
+  for (;;) {
+#ifndef HOST_BUILD
+    __disable_irq();
+#endif
+    if (*flag) break;
+    Idle_Sleep();
+  }
+#ifndef HOST_BUILD
+  __enable_irq();
+#endif
+}
+
+/*******************************************************************************
+* Function Name  : Idle_WaitEvent
+* Description    : Sleep until the next interrupt of any kind. Unlike
+*                  Idle_WaitFlag() there is nothing to check, so an interrupt
+*                  just before the call is not seen; SysTick bounds the extra
+*                  wait to 1 ms.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_WaitEvent(void)
+{
+#ifndef HOST_BUILD
+  __disable_irq();
+#endif
+  Idle_Sleep();
+}
+
+/*******************************************************************************
+* Function Name  : Idle_EndFrame
+* Description    : Close the current frame: utilization is the share of its
+*                  ticks spent outside WFI
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_EndFrame(void)
+{
+  uint32_t now = Prof_Now();
+  uint32_t wall = now - idleFrameStart;
+  uint32_t sleep = idleFrameSleep;
+
+  if (sleep > wall) sleep = wall;
+  idleLastUtil = wall ? (uint32_t)((uint64_t)(wall - sleep) * 1000 / wall) : 0;
+  if (idleLastUtil > idleMaxUtil) idleMaxUtil = idleLastUtil;
+  idleWallTicks += wall;
+  idleFrames++;
+
+  idleFrameStart = now;
+  idleFrameSleep = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Idle_AbortFrame
+* Description    : Drop the open frame, so sleeping on the start and game over
+*                  screens is not charged to the first game frame
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_AbortFrame(void)
+{
+  idleSleepTicks -= idleFrameSleep;
+  idleFrameSleep = 0;
+  idleFrameStart = Prof_Now();
+}
+
+/*******************************************************************************
+* Function Name  : Idle_GetStats
+* Description    : Copy the counters
+* Input          : stats -- destination
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_GetStats(IdleStats *stats)
+{
+  stats->wallTicks = idleWallTicks;
+  stats->sleepTicks = idleSleepTicks;
+  stats->frames = idleFrames;
+  stats->lastUtilPermille = idleLastUtil;
+  stats->maxUtilPermille = idleMaxUtil;
+}
+
+/*******************************************************************************
+* Function Name  : Idle_UtilPermille
+* Description    : Overall CPU utilization over all closed frames
+* Input          : None
+* Output         : None
+* Return         : Active ticks per 1000 wall ticks
+*******************************************************************************/
+uint32_t Idle_UtilPermille(void)
+{
+  if (idleWallTicks == 0) return 0;
+  if (idleSleepTicks >= idleWallTicks) return 0;
+  return (uint32_t)((idleWallTicks - idleSleepTicks) * 1000 / idleWallTicks);
+}
+
+/*******************************************************************************
+* Function Name  : Idle_AppendPermille
+* Description    : Append name and a permille value as a percentage (38.2%)
+*******************************************************************************/
+static unsigned int Idle_AppendPermille(char *buf, unsigned int pos, const char *name, uint32_t permille)
+{
+  pos = Fmt_AppendText(buf, pos, name);
+  pos = Fmt_AppendUInt(buf, pos, permille / 10);
+  buf[pos++] = '.';
+  pos = Fmt_AppendUInt(buf, pos, permille % 10);
+  buf[pos++] = '%';
+  return pos;
+}
+
+/*******************************************************************************
+* Function Name  : Idle_Dump
+* Description    : Write the utilization as one line of text:
+*                    cpu frames=1200 util=38.2% last=37.9% max=61.0%
+*                  util= is over all recorded frames, last= and max= are
+*                  single frames.
+* Input          : write -- called once per line (e.g. a UART transmit)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Idle_Dump(void (*write)(const char *text, unsigned int length))
+{
+  char line[80];
+  unsigned int pos = 0;
+  const char *head = "cpu frames=";
+
+  while (*head) {
+    line[pos++] = *head++;
+  }
+  pos = Fmt_AppendUInt(line, pos, idleFrames);
+  pos = Idle_AppendPermille(line, pos, " util=", Idle_UtilPermille());
+  pos = Idle_AppendPermille(line, pos, " last=", idleLastUtil);
+  pos = Idle_AppendPermille(line, pos, " max=", idleMaxUtil);
+  line[pos++] = '\r';
+  line[pos++] = '\n';
+  write(line, pos);
+}
@@ -0,0 +1,190 @@
+/**
+ ******************************************************************************
+ * @file    input.c
+ * @brief   Interrupt-driven jump button with debounce and an event queue
+ ******************************************************************************
+ *
+ * See input.h. The queue indices are single bytes, so each side's update is
+ * one store; the producer writes an event before publishing it through
+ * inputHead, the consumer reads it before releasing it through inputTail.
+ *
+ ******************************************************************************
+ */
+
+#include "input.h"
+#include "profiler.h"
+#include "fmt.h"
+
+static InputEvent inputQueue[INPUT_QUEUE_SIZE];
+static volatile unsigned char inputHead = 0;    // Written by the interrupt side only
+static volatile unsigned char inputTail = 0;    // Written by Input_Poll only
+static volatile unsigned long inputDropped = 0;
+
+// Debounce state (interrupt side)
+static volatile unsigned char inputLevel = 0;   // Debounced level
+static unsigned char inputLocked = 0;           // In the lockout after an accepted edge
+static uint32_t inputLockStart;
+
+/*******************************************************************************
+* Function Name  : Input_ReadPin
+* Description    : Raw button level, 1 -- pressed
+*******************************************************************************/
+static unsigned char Input_ReadPin(void)
+{
+  return HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN) == GPIO_PIN_SET;
+}
+
+/*******************************************************************************
+* Function Name  : Input_Accept
+* Description    : Take a level change: queue it and start the lockout
+*******************************************************************************/
+static void Input_Accept(unsigned char level, uint32_t now)
+{
+  unsigned char head = inputHead;
+  unsigned char next = (unsigned char)((head + 1) & (INPUT_QUEUE_SIZE - 1));
+
+  inputLevel = level;
+  inputLocked = 1;
+  inputLockStart = now;
+
+  if (next == inputTail) {
+    inputDropped++;
+    return;
+  }
+  inputQueue[head].pressed = level;
+  inputQueue[head].tick = now;
+  inputQueue[head].cycles = Prof_Now();
+  inputHead = next;       // Publish after the event is written
+}
+
+/*******************************************************************************
+* Function Name  : Input_Init
+* Description    : Take the current pin level as the debounced state, empty
+*                  the queue and enable the button's EXTI interrupt. The pin
+*                  itself is set up for both edges in MX_GPIO_Init().
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Input_Init(void)
+{
+  HAL_NVIC_DisableIRQ(BUTTON_EXTI_IRQn);
+  inputLevel = Input_ReadPin();
+  inputLocked = 0;
+  inputTail = inputHead;
+  inputDropped = 0;
+  __HAL_GPIO_EXTI_CLEAR_IT(BUTTON_PIN);
+
+  // Same priority as SysTick: the two producers never preempt each other
+  HAL_NVIC_SetPriority(BUTTON_EXTI_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(BUTTON_EXTI_IRQn);
+}
+
+/*******************************************************************************
+* Function Name  : Input_EdgeIRQ
+* Description    : EXTI edge on the button. Outside the lockout a change of
+*                  level is accepted at once; inside it the edge is bounce.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Input_EdgeIRQ(void)
+{
+  unsigned char level;
+
+  if (inputLocked) return;
+  level = Input_ReadPin();
+  if (level != inputLevel) Input_Accept(level, HAL_GetTick());
+}
+
+/*******************************************************************************
+* Function Name  : Input_TickIRQ
+* Description    : 1 ms tick. Ends the lockout and catches a level change
+*                  whose last edge fell inside it.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Input_TickIRQ(void)
+{
+  uint32_t now;
+  unsigned char level;
+
+  if (!inputLocked) return;
+  now = HAL_GetTick();
+  if (now - inputLockStart < INPUT_DEBOUNCE_MS) return;
+
+  inputLocked = 0;
+  level = Input_ReadPin();
+  if (level != inputLevel) Input_Accept(level, now);
+}
+
+/*******************************************************************************
+* Function Name  : Input_Poll
+* Description    : Take the oldest event from the queue
+* Input          : event -- destination
+* Output         : None
+* Return         : 0 -- queue empty
+                   1 -- *event filled in
+*******************************************************************************/
+unsigned char Input_Poll(InputEvent *event)
+{
+  unsigned char tail = inputTail;
+
+  if (tail == inputHead) return 0;
+  *event = inputQueue[tail];
+  inputTail = (unsigned char)((tail + 1) & (INPUT_QUEUE_SIZE - 1));   // Release after the read
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Input_TakePress
+* Description    : For "press to continue" screens: drop queued events up to
+*                  and including the first press
+* Input          : None
+* Output         : None
+* Return         : 1 -- a press was queued
+*******************************************************************************/
+unsigned char Input_TakePress(void)
+{
+  InputEvent event;
+
+  while (Input_Poll(&event)) {
+    if (event.pressed) return 1;
+  }
+  return 0;
+}
+
+/*******************************************************************************
+* Function Name  : Input_Flush
+* Description    : Drop every queued event (e.g. presses made before a screen
+*                  appeared)
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Input_Flush(void)
+{
+  inputTail = inputHead;
+}
+
+/*******************************************************************************
+* Function Name  : Input_Dump
+* Description    : Write the queue state as one line of text:
+*                    input dropped=0
+*                  dropped= counts events lost to a full queue since
+*                  Input_Init().
+* Input          : write -- called once per line (e.g. a UART transmit)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Input_Dump(void (*write)(const char *text, unsigned int length))
+{
+  char line[32];
+  unsigned int pos;
+
+  pos = Fmt_AppendText(line, 0, "input dropped=");
+  pos = Fmt_AppendUInt(line, pos, inputDropped);
+  pos = Fmt_AppendText(line, pos, "\r\n");
+  write(line, pos);
+}
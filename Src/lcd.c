@@ -1,4 +1,6 @@
+#include <string.h>
 #include "lcd.h"
+#include "fmt.h"
 
 unsigned char ChineseTable[][16] = {
 	//0x83,0x83,0x83,0xff,0xff,0x83,0x83,0x83,0xc1,0xc1,0xc1,0xff,0xff,0xc1,0xc1,0xc1,
@@ -498,6 +500,190 @@ unsigned char DispSTLoGoTable[] = {
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
 };
+/* Bus timing ----------------------------------------------------------------*/
+static unsigned int lcdBusWaitLoops = 0;      // Extra spins after each access
+static unsigned int lcdLoopsPerUs = 1;        // Spin iterations per microsecond
+static unsigned char lcdFsmcAddset = LCD_FSMC_ADDSET_MAX;   // As in the BTR;
+static unsigned char lcdFsmcDatast = LCD_FSMC_DATAST_MAX;   // safe at any clock
+
+/* Shadow of the controller cursor ---------------------------------------------*/
+// The controller auto-increments the column on every data write, so the next
+// access is often already addressed. LCD_CURSOR_UNKNOWN means the state has
+// to be sent.
+#define LCD_CURSOR_UNKNOWN   0xFF
+#define LCD_COL_LAST         131      // Column counter stops here (132 columns)
+
+static unsigned char lcdCurPage = LCD_CURSOR_UNKNOWN;
+static unsigned char lcdCurCol = LCD_CURSOR_UNKNOWN;
+static unsigned char lcdCurStartLine = LCD_CURSOR_UNKNOWN;
+static unsigned int lcdAddrCmdsSent = 0;      // Since the last swap/flush
+// Set while a DMA run is on the bus. The shadow already holds the column the
+// run will end at, so nothing may address the controller until it is done.
+static volatile unsigned char lcdDmaInFlight = 0;
+static unsigned int lcdAddrCmdsSaved = 0;
+
+/* Bus traffic per swap/flush --------------------------------------------------*/
+// Counts run from the start of one LCD_SwapBuffers()/LCD_FlushBuffer() to the
+// start of the next, so the DMA tail and any direct drawing in between land
+// in the frame that caused them.
+static LCD_FrameTraffic lcdTraffic;           // Frame being counted
+static LCD_FrameTraffic lcdTrafficLast;       // Last recorded frame
+static LCD_TrafficStats lcdTrafficStats;
+static unsigned char lcdTrafficOpen = 0;      // A swap/flush has started a frame
+
+/*******************************************************************************
+* Function Name  : LCD_WriteCmd / LCD_WriteData / LCD_ReadData
+* Description    : Single access on the LCD bus, padded out to the controller's
+*                  cycle time (see LCD_BusTimingInit)
+*******************************************************************************/
+static inline void LCD_WriteCmd(unsigned char cmd)
+{
+  LCD_BUS_WRITE_CMD(cmd);
+  if (lcdBusWaitLoops) LCD_BusWait();
+  lcdTraffic.cmdBytes++;
+}
+
+static inline void LCD_WriteData(unsigned char data)
+{
+  LCD_BUS_WRITE_DATA(data);
+  if (lcdBusWaitLoops) LCD_BusWait();
+  lcdTraffic.dataBytes++;
+  if (lcdCurCol < LCD_COL_LAST) lcdCurCol++;
+}
+
+static inline unsigned char LCD_ReadData(void)
+{
+  unsigned char data = LCD_BUS_READ_DATA();
+  if (lcdBusWaitLoops) LCD_BusWait();
+  lcdCurCol = LCD_CURSOR_UNKNOWN;   // Only the non-dummy reads advance it
+  return data;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SendAddress
+* Description    : Point the controller at page/col, sending only the address
+*                  commands whose value differs from the shadow cursor. The
+*                  flush itself calls this while it owns the bus; everything
+*                  else goes through LCD_SetAddress().
+* Input          : page -- page number (0-7)
+*                  col -- column (0-131)
+*******************************************************************************/
+static void LCD_SendAddress(unsigned char page, unsigned char col)
+{
+  unsigned int sent = lcdAddrCmdsSent;
+  
+  assert_param(!lcdDmaInFlight);
+  
+  if (page != lcdCurPage) {
+    LCD_WriteCmd(Set_Page_Addr_X | page);
+    lcdCurPage = page;
+    lcdAddrCmdsSent++;
+  } else {
+    lcdAddrCmdsSaved++;
+  }
+  
+  if (lcdCurCol == LCD_CURSOR_UNKNOWN || (col >> 4) != (lcdCurCol >> 4)) {
+    LCD_WriteCmd(Set_ColH_Addr_X | (col >> 4));
+    lcdAddrCmdsSent++;
+  } else {
+    lcdAddrCmdsSaved++;
+  }
+  if (lcdCurCol == LCD_CURSOR_UNKNOWN || (col & 0x0F) != (lcdCurCol & 0x0F)) {
+    LCD_WriteCmd(Set_ColL_Addr_X | (col & 0x0F));
+    lcdAddrCmdsSent++;
+  } else {
+    lcdAddrCmdsSaved++;
+  }
+  lcdCurCol = col;
+  if (lcdAddrCmdsSent != sent) lcdTraffic.reAddr++;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SetAddress
+* Description    : LCD_SendAddress() for the direct drawing paths. A DMA flush
+*                  moves the shadow cursor from its interrupt and its bytes
+*                  would interleave with ours, so let it finish first.
+* Input          : page -- page number (0-7)
+*                  col -- column (0-131)
+*******************************************************************************/
+static void LCD_SetAddress(unsigned char page, unsigned char col)
+{
+  LCD_WaitFlush();
+  LCD_SendAddress(page, col);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SendStartLine
+* Description    : Set the display start line unless it is already set. Flush
+*                  paths only, as LCD_SendAddress().
+* Input          : line -- start line (0-63)
+*******************************************************************************/
+static void LCD_SendStartLine(unsigned char line)
+{
+  assert_param(!lcdDmaInFlight);
+  
+  if (line != lcdCurStartLine) {
+    LCD_WriteCmd(Set_Start_Line_X | line);
+    lcdCurStartLine = line;
+    lcdAddrCmdsSent++;
+  } else {
+    lcdAddrCmdsSaved++;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SetStartLine
+* Description    : LCD_SendStartLine() for the direct drawing paths
+* Input          : line -- start line (0-63)
+*******************************************************************************/
+static void LCD_SetStartLine(unsigned char line)
+{
+  LCD_WaitFlush();
+  LCD_SendStartLine(line);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_RMW_Begin / LCD_RMW_Byte / LCD_RMW_End
+* Description    : Read-modify-write mode. Reads do not advance the column and
+*                  writes do, so each byte costs a dummy read, a read and a
+*                  write with no re-addressing. Leaving the mode puts the column
+*                  back where LCD_RMW_Begin() set it.
+*******************************************************************************/
+static unsigned char lcdRmwCol;
+
+static void LCD_RMW_Begin(unsigned char page, unsigned char col)
+{
+  LCD_SetAddress(page, col);
+  LCD_WriteCmd(RMW_Mode_En);
+  lcdRmwCol = col;
+}
+
+static void LCD_RMW_Byte(unsigned char mask, unsigned char bits)
+{
+  unsigned char current_data;
+  
+  current_data = LCD_ReadData();  // Dummy read
+  current_data = LCD_ReadData();  // Actual read
+  LCD_WriteData((current_data & ~mask) | (bits & mask));
+}
+
+static void LCD_RMW_End(void)
+{
+  LCD_WriteCmd(RMW_Mode_Dis);
+  lcdCurCol = lcdRmwCol;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_InvalidateCursor
+* Description    : Forget the shadow cursor, e.g. after a controller reset
+*******************************************************************************/
+static void LCD_InvalidateCursor(void)
+{
+  lcdCurPage = LCD_CURSOR_UNKNOWN;
+  lcdCurCol = LCD_CURSOR_UNKNOWN;
+  lcdCurStartLine = LCD_CURSOR_UNKNOWN;
+}
+
 /*******************************************************************************/
 void Converse_Logo(void)
 {
@@ -523,26 +709,20 @@ void LCD_Draw_ST_Logo()
   unsigned char i,j;
   unsigned char *p=DispSTLoGoTable;
   
-  LCD_Command = COM_Scan_Dir_Reverse;
+  LCD_WaitFlush();
+  LCD_WriteCmd(COM_Scan_Dir_Reverse);
   
-  LCD_Command = Set_Start_Line_X|0x0;
-  delay();
+  LCD_SetStartLine(0);
   
   for (i=0; i<8; i++)
   {
     // for each page 
-    LCD_Command = Set_Page_Addr_X|i; // page no.
-    delay();
-    LCD_Command = Set_ColH_Addr_X|0x0; // fixed col first addr
-    delay();
-    LCD_Command = Set_ColL_Addr_X|0x0;
-    delay();
+    LCD_SetAddress(i, 0); // page no., first col
     
     j=128;
     while (j--)
     {
-      LCD_Data=*p++;
-      delay();
+      LCD_WriteData(*p++);
     }
   }
 
@@ -560,27 +740,19 @@ void LCD_Draw_ST_Logo()
 void LCD_DrawChar(unsigned char Xpage, unsigned char YCol, unsigned char offset)
 {  
   int i=8;
-  unsigned char coll = YCol & 0x0f;
-  unsigned char colh = YCol >> 4;
   unsigned char *c = ChineseTable[0]+16*offset;
   
-  LCD_Command = Set_Start_Line_X|0x0;   delay();
-  LCD_Command = Set_Page_Addr_X|Xpage;  delay();
-  LCD_Command = Set_ColH_Addr_X|colh;   delay();
-  LCD_Command = Set_ColL_Addr_X|coll;   delay();
+  LCD_SetStartLine(0);
+  LCD_SetAddress(Xpage, YCol);
   while (i--)
   {
-    LCD_Data=*c++;
-    delay();
+    LCD_WriteData(*c++);
   }
   i=8;
-  LCD_Command = Set_Page_Addr_X|(Xpage+1);  delay();
-  LCD_Command = Set_ColH_Addr_X|colh;       delay();
-  LCD_Command = Set_ColL_Addr_X|coll;       delay();
+  LCD_SetAddress(Xpage+1, YCol);
   while(i--)
   {
-    LCD_Data=*c++;
-    delay();
+    LCD_WriteData(*c++);
   }
 }
 /*******************************************************************************
@@ -612,29 +784,166 @@ unsigned char* pOffset = c;
     return 1;
   }
 }
-void delay(void)
+#ifndef HOST_BUILD
+/*******************************************************************************
+* Function Name  : LCD_FSMCTiming
+* Description    : Bank 4 timing (mode 1) with the current ADDSET/DATAST
+* Input          : p -- timing structure to fill
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_FSMCTiming(FSMC_NORSRAM_TimingTypeDef *p)
 {
-  volatile unsigned char i=0x8;
-  while(i--)
-	{
-		//asm("NOP");
-	}
+  p->AddressSetupTime = lcdFsmcAddset;
+  p->AddressHoldTime = 1;
+  p->DataSetupTime = lcdFsmcDatast;
+  p->BusTurnAroundDuration = 0;
+  p->CLKDivision = 0;
+  p->DataLatency = 1;
+  p->AccessMode = (unsigned long)0x00000000;
+}
+#endif /* HOST_BUILD */
 
+/*******************************************************************************
+* Function Name  : LCD_BusTimingInit
+* Description    : Works out the FSMC timing for SystemCoreClock, the fewest
+*                  HCLK that still meet t_PW and t_CYC, and writes it to the
+*                  bank 4 BTR register. Waits for the flush first, since the
+*                  DMA may still be using the bank.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_BusTimingInit(void)
+{
+  unsigned long khz = SystemCoreClock / 1000;
+  unsigned int mhz = SystemCoreClock / 1000000;
+  unsigned int datast, cycles, addset;
+  unsigned int cycleNs, pulseNs;
+  unsigned int shortNs = 0;
+#ifndef HOST_BUILD
+  FSMC_NORSRAM_TimingTypeDef p;
+#endif
+
+  if (khz == 0) khz = 1;
+  if (mhz == 0) mhz = 1;
+
+  // HCLK needed for the pulse and for the whole access, rounded up. The
+  // access is ADDSET + DATAST + 1 HCLK with WR/RD low for DATAST.
+  datast = (LCD_T_PW_NS * khz + 999999) / 1000000;
+  cycles = (LCD_T_CYC_NS * khz + 999999) / 1000000;
+  if (datast < 1) datast = 1;
+  addset = (cycles > datast + 2) ? cycles - datast - 1 : 1;
+  if (addset > LCD_FSMC_ADDSET_MAX) {
+    datast += addset - LCD_FSMC_ADDSET_MAX;
+    addset = LCD_FSMC_ADDSET_MAX;
+  }
+  if (datast > LCD_FSMC_DATAST_MAX) datast = LCD_FSMC_DATAST_MAX;
+
+  LCD_WaitFlush();
+  lcdFsmcAddset = addset;
+  lcdFsmcDatast = datast;
+#ifndef HOST_BUILD
+  LCD_FSMCTiming(&p);
+  FSMC_NORSRAM_Timing_Init(FSMC_NORSRAM_DEVICE, &p, FSMC_NORSRAM_BANK4);
+#else
+  LCD_Emu_SetTiming(addset, datast, SystemCoreClock);
+#endif
+
+  // Whatever the fields could not cover is left to LCD_BusWait()
+  cycleNs = (unsigned int)(((unsigned long)(addset + datast + 1) * 1000000 + khz - 1) / khz);
+  pulseNs = (unsigned int)(((unsigned long)datast * 1000000 + khz - 1) / khz);
+  if (cycleNs < LCD_T_CYC_NS) shortNs = LCD_T_CYC_NS - cycleNs;
+  if (pulseNs < LCD_T_PW_NS && LCD_T_PW_NS - pulseNs > shortNs) shortNs = LCD_T_PW_NS - pulseNs;
+
+  lcdLoopsPerUs = (mhz + LCD_SPIN_CYCLES - 1) / LCD_SPIN_CYCLES;
+  lcdBusWaitLoops = (shortNs * lcdLoopsPerUs + 999) / 1000;
 }
 
-  
+/*******************************************************************************
+* Function Name  : LCD_GetBusTiming
+* Description    : FSMC timing LCD_BusTimingInit() last wrote
+* Input          : None
+* Output         : addset, datast -- HCLK cycles
+* Return         : None
+*******************************************************************************/
+void LCD_GetBusTiming(unsigned char *addset, unsigned char *datast)
+{
+  *addset = lcdFsmcAddset;
+  *datast = lcdFsmcDatast;
+}
 
-void reset_delay(void)
+/*******************************************************************************
+* Function Name  : LCD_GetBusWaitLoops
+* Description    : Spin count LCD_BusWait() uses at the current clock
+* Input          : None
+* Output         : None
+* Return         : 0 when the FSMC timing alone meets the controller's
+*******************************************************************************/
+unsigned int LCD_GetBusWaitLoops(void)
+{
+  return lcdBusWaitLoops;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_BusWait
+* Description    : Waits out the part of the controller's cycle time the FSMC
+*                  access did not cover
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_BusWait(void)
 {
-  volatile unsigned long i=0xff;
-  while(i--);
+  volatile unsigned int i = lcdBusWaitLoops;
+  while (i--);
 }
 
+/*******************************************************************************
+* Function Name  : LCD_DelayUs
+* Description    : Busy wait of at least the given number of microseconds
+* Input          : us - microseconds
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_DelayUs(unsigned int us)
+{
+  volatile unsigned int i = us * lcdLoopsPerUs;
+  while (i--);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_WaitReady
+* Description    : Polls the status register until BUSY and RESET are clear
+* Input          : timeoutUs - give up after roughly this many microseconds
+* Output         : None
+* Return         : 0 -- timed out
+                   1 -- ready
+*******************************************************************************/
+unsigned char LCD_WaitReady(unsigned int timeoutUs)
+{
+  do
+  {
+    if ((LCD_BUS_READ_STATUS() & (LCD_STATUS_BUSY | LCD_STATUS_RESET)) == 0) return 1;
+    LCD_DelayUs(1);
+  } while (timeoutUs--);
+  return 0;
+}
+
+void delay(void)
+{
+  LCD_BusWait();
+}
+
+void reset_delay(void)
+{
+  // Status polling where the panel supports it, the datasheet time otherwise
+  if (!LCD_WaitReady(LCD_T_RESET_US * 10)) LCD_DelayUs(LCD_T_RESET_US);
+}
 
 void power_delay(void)
 {
-  volatile unsigned long i=0x4ffff;
-  while(i--);
+  HAL_Delay(LCD_T_POWER_MS);
 }
 
 
@@ -647,53 +956,41 @@ void power_delay(void)
 *******************************************************************************/
 void STM3210E_LCD_Init(void)
 {  
+  LCD_WaitFlush();
+
 /* Configure the LCD Control pins --------------------------------------------*/
   LCD_CtrlLinesConfig();
 
 /* Configure the FSMC Parallel interface -------------------------------------*/
   LCD_FSMCConfig();
-  
+  LCD_BusTimingInit();
 
-  LCD_Command = Display_Off; //
-  delay();
-  LCD_Command = LCD_Reset; //
+  LCD_WriteCmd(Display_Off); //
+  LCD_WriteCmd(LCD_Reset); //
   reset_delay();
+  LCD_InvalidateCursor();
   
-  LCD_Command = Set_LCD_Bias_9;
-  delay();
-  LCD_Command = Set_ADC_Normal;
-  delay();
-  LCD_Command = COM_Scan_Dir_Reverse;
-  delay();
-  LCD_Command = Set_Start_Line_X|0x0;
-  delay();
+  LCD_WriteCmd(Set_LCD_Bias_9);
+  LCD_WriteCmd(Set_ADC_Normal);
+  LCD_WriteCmd(COM_Scan_Dir_Reverse);
+  LCD_SetStartLine(0);
   
-  LCD_Command = 0x2c;
+  LCD_WriteCmd(0x2c);
   power_delay(); // 50ms requried
-  LCD_Command = 0x2e;
+  LCD_WriteCmd(0x2e);
   power_delay(); // 50ms
-  LCD_Command = 0x2f;
+  LCD_WriteCmd(0x2f);
   power_delay(); // 50ms
   
-  LCD_Command = Set_Ref_Vol_Reg|0x05;
-  delay();
-  LCD_Command = Set_Ref_Vol_Mode;
-  delay();
-  LCD_Command = Set_Ref_Vol_Reg;
-  delay();
+  LCD_WriteCmd(Set_Ref_Vol_Reg|0x05);
+  LCD_WriteCmd(Set_Ref_Vol_Mode);
+  LCD_WriteCmd(Set_Ref_Vol_Reg);
   
   LCD_Clear();
-  delay();
-  
-  LCD_Command = Set_Page_Addr_X|0x0;
-  delay();
-  LCD_Command = Set_ColH_Addr_X|0x0;
-  delay();
-  LCD_Command = Set_ColL_Addr_X|0x0;
-  delay();
+  
+  LCD_SetAddress(0, 0);
  
-  LCD_Command = Display_On; //
-  delay();
+  LCD_WriteCmd(Display_On); //
 }
 
 
@@ -710,23 +1007,18 @@ void LCD_Clear(void)
   unsigned char i,j=128;
   unsigned char data=0x0;
   
-  LCD_Command = Set_Start_Line_X|0x0; // start line
-    delay();
+  LCD_WaitFlush();  // Bus may still be busy with a DMA flush
+  
+  LCD_SetStartLine(0); // start line
     
   for (i=0; i<8; i++)
   {
     // for each page 
-    LCD_Command = Set_Page_Addr_X|i; // page no.
-    delay();
-    LCD_Command = Set_ColH_Addr_X|0x0; // fixed col first addr
-    delay();
-    LCD_Command = Set_ColL_Addr_X|0x0;
-    delay();
+    LCD_SetAddress(i, 0); // page no., first col
     
     while (j--)
     {
-      LCD_Data=data;
-      delay();
+      LCD_WriteData(data);
     }
   }
 }
@@ -744,33 +1036,20 @@ void LCD_Reset_Cursor(void)
   unsigned char i=16;
   unsigned char data=0xff;
   
-  LCD_Command = Set_Start_Line_X|0x0; // start line
-  delay();
+  LCD_SetStartLine(0); // start line
   //page 3
-  LCD_Command = Set_Page_Addr_X|3; 
-  delay();
   //column 0x38
-  LCD_Command = Set_ColH_Addr_X|0x3; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|0x8;
-  delay();
+  LCD_SetAddress(3, 0x38);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
   i=16;
   //page 4
-  LCD_Command = Set_Page_Addr_X|4; 
-  delay();
-  LCD_Command = Set_ColH_Addr_X|0x3; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|0x8;
-  delay();
+  LCD_SetAddress(4, 0x38);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
 }
 
@@ -790,38 +1069,22 @@ void LCD_Clr_Cursor(signed char x)
   unsigned char data=0x00;
   
   unsigned char col_no; //0x38+x
-  unsigned char col_high;
-  unsigned char col_low;
   col_no=0x40+(x_p/8 -1)*8; //0x38+x
-  col_high=col_no>>4;
-  col_low=col_no&0xf;
   
   
   //page 3
-  LCD_Command = Set_Page_Addr_X|3; 
-  delay();
   //column 0x38
-  LCD_Command = Set_ColH_Addr_X|col_high; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|col_low;
-  delay();
+  LCD_SetAddress(3, col_no);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
   i=16;
   //page 4
-  LCD_Command = Set_Page_Addr_X|4; 
-  delay();
-  LCD_Command = Set_ColH_Addr_X|col_high; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|col_low;
-  delay();
+  LCD_SetAddress(4, col_no);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
 }
 
@@ -840,39 +1103,23 @@ void LCD_Set_Cursor(signed char x)
   unsigned char data=0xff;
   
   unsigned char col_no; //0x38+x
-  unsigned char col_high;
-  unsigned char col_low;
   col_no=0x40+(x/8 -1)*8; //0x38+x
-  col_high=col_no>>4;
-  col_low=col_no&0xf;
   
   //page 3
-  LCD_Command = Set_Page_Addr_X|3; 
-  delay();
   //column diff with x-postion
   
   
-  LCD_Command = Set_ColH_Addr_X|col_high; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|col_low;
-  delay();
+  LCD_SetAddress(3, col_no);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
   i=16;
   //page 4
-  LCD_Command = Set_Page_Addr_X|4; 
-  delay();
-  LCD_Command = Set_ColH_Addr_X|col_high; 
-  delay();
-  LCD_Command = Set_ColL_Addr_X|col_low;
-  delay();
+  LCD_SetAddress(4, col_no);
   while (i--) // write 16 column
   {
-    LCD_Data=data;
-    delay();
+    LCD_WriteData(data);
   }
 }
 
@@ -886,12 +1133,10 @@ void LCD_Set_Cursor(signed char x)
 *******************************************************************************/
 void LCD_PowerOn(void)
 {
-  LCD_Command = 0x2c;
-  delay();
-  LCD_Command = 0x2e;
-  delay();
-  LCD_Command = 0x2f;
-  delay();
+  LCD_WaitFlush();
+  LCD_WriteCmd(0x2c);
+  LCD_WriteCmd(0x2e);
+  LCD_WriteCmd(0x2f);
 }
 
 /*******************************************************************************
@@ -903,7 +1148,8 @@ void LCD_PowerOn(void)
 *******************************************************************************/
 void LCD_DisplayOn(void)
 {
-  LCD_Command = Display_On;
+  LCD_WaitFlush();
+  LCD_WriteCmd(Display_On);
 }
 
 /*******************************************************************************
@@ -915,7 +1161,8 @@ void LCD_DisplayOn(void)
 *******************************************************************************/
 void LCD_DisplayOff(void)
 {
-  LCD_Command = Display_Off;
+  LCD_WaitFlush();
+  LCD_WriteCmd(Display_Off);
 }
 
 /*******************************************************************************
@@ -928,6 +1175,7 @@ void LCD_DisplayOff(void)
 *******************************************************************************/
 void LCD_CtrlLinesConfig(void)
 {
+#ifndef HOST_BUILD
 	__HAL_RCC_GPIOA_CLK_ENABLE();
 	__HAL_RCC_GPIOB_CLK_ENABLE();
 	__HAL_RCC_GPIOC_CLK_ENABLE();
@@ -975,6 +1223,7 @@ void LCD_CtrlLinesConfig(void)
   GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
   GPIO_InitStruct.Speed = GPIO_SPEED_HIGH;
   HAL_GPIO_Init(GPIOG, &GPIO_InitStruct);
+#endif /* HOST_BUILD */
 }
 
 /*******************************************************************************
@@ -986,6 +1235,7 @@ void LCD_CtrlLinesConfig(void)
 *******************************************************************************/
 void LCD_FSMCConfig(void)
 { 
+#ifndef HOST_BUILD
   //FSMC_NORSRAMInitTypeDef  FSMC_NORSRAMInitStructure;
   //FSMC_NORSRAMTimingInitTypeDef  p;
 	SRAM_HandleTypeDef hsram4;
@@ -993,14 +1243,8 @@ void LCD_FSMCConfig(void)
 
 /*-- FSMC Configuration ------------------------------------------------------*/
 /*----------------------- SRAM Bank 4 ----------------------------------------*/
-  /* FSMC_Bank1_NORSRAM4 configuration */
-  p.AddressSetupTime = 1;
-  p.AddressHoldTime = 1;
-  p.DataSetupTime = 20;
-  p.BusTurnAroundDuration = 0;
-  p.CLKDivision = 0;
-  p.DataLatency = 1;
-  p.AccessMode = (unsigned long)0x00000000;
+  /* FSMC_Bank1_NORSRAM4 configuration - LCD_BusTimingInit() tightens it */
+  LCD_FSMCTiming(&p);
 
 	hsram4.Instance = FSMC_NORSRAM_DEVICE;
   hsram4.Extended = FSMC_NORSRAM_EXTENDED_DEVICE;
@@ -1058,6 +1302,7 @@ void LCD_FSMCConfig(void)
   /* BANK 4 (of NOR/SRAM Bank 1~4) is enabled */
 	
   //FSMC_NORSRAMCmd(FSMC_Bank1_NORSRAM4, ENABLE);
+#endif /* HOST_BUILD */
 }
 /*******************************************************************************
 * Function Name  : LCD_SetPixel
@@ -1073,8 +1318,7 @@ void LCD_FSMCConfig(void)
 *******************************************************************************/
 unsigned char LCD_SetPixel(unsigned char x, unsigned char y, unsigned char state)
 {
-  unsigned char page, bit_position, current_data;
-  unsigned char col_high, col_low;
+  unsigned char page, bit_position;
   
   // Boundary check
   if (x >= 128 || y >= 64)
@@ -1084,43 +1328,10 @@ unsigned char LCD_SetPixel(unsigned char x, unsigned char y, unsigned char state
   page = y / 8;           // Page number (0-7)
   bit_position = y % 8;   // Bit position within the page (0-7)
   
-  // Calculate column address
-  col_high = x >> 4;      // High nibble of column
-  col_low = x & 0x0F;     // Low nibble of column
-  
-  // Set page and column address
-  LCD_Command = Set_Page_Addr_X | page;
-  delay();
-  LCD_Command = Set_ColH_Addr_X | col_high;
-  delay();
-  LCD_Command = Set_ColL_Addr_X | col_low;
-  delay();
-  
-  // Read current data (dummy read to set address)
-  current_data = LCD_Data;
-  delay();
-  
-  // Read actual data
-  current_data = LCD_Data;
-  delay();
-  
-  // Modify the specific bit
-  if (state)
-    current_data |= (1 << bit_position);   // Set bit
-  else
-    current_data &= ~(1 << bit_position);  // Clear bit
-  
-  // Write back - need to reset address first
-  LCD_Command = Set_Page_Addr_X | page;
-  delay();
-  LCD_Command = Set_ColH_Addr_X | col_high;
-  delay();
-  LCD_Command = Set_ColL_Addr_X | col_low;
-  delay();
-  
-  // Write modified data
-  LCD_Data = current_data;
-  delay();
+  // Read, modify and write back in RMW mode - no second address set needed
+  LCD_RMW_Begin(page, x);
+  LCD_RMW_Byte(1 << bit_position, state ? 0xFF : 0x00);
+  LCD_RMW_End();
   
   return 1;
 }
@@ -1136,7 +1347,6 @@ unsigned char LCD_SetPixel(unsigned char x, unsigned char y, unsigned char state
 *******************************************************************************/
 unsigned char LCD_DrawLine(unsigned char x1, unsigned char x2, unsigned char y, unsigned char state)
 {
-  unsigned char x;
   unsigned char start_x, end_x;
   
   if (y >= 64)
@@ -1154,16 +1364,11 @@ unsigned char LCD_DrawLine(unsigned char x1, unsigned char x2, unsigned char y,
     end_x = x1;
   }
   
-  if (end_x >= 128)
-    end_x = 127;
-  
-  // Draw pixels from start to end
-  for (x = start_x; x <= end_x; x++)
-  {
-    LCD_SetPixel(x, y, state);
-  }
+  if (start_x >= 128)
+    return 1;   // Nothing on screen
   
-  return 1;
+  // One page, one RMW pass along the columns
+  return LCD_SetArea(start_x, y, end_x, y, state);
 }
 
 /*******************************************************************************
@@ -1309,7 +1514,6 @@ unsigned char LCD_FillCircle(unsigned char xc, unsigned char yc, unsigned char r
 *******************************************************************************/
 unsigned char LCD_DrawVLine(unsigned char x, unsigned char y1, unsigned char y2, unsigned char state)
 {
-  unsigned char y;
   unsigned char start_y, end_y;
   
   if (x >= 128)
@@ -1327,16 +1531,11 @@ unsigned char LCD_DrawVLine(unsigned char x, unsigned char y1, unsigned char y2,
     end_y = y1;
   }
   
-  if (end_y >= 64)
-    end_y = 63;
-  
-  // Draw pixels from start to end
-  for (y = start_y; y <= end_y; y++)
-  {
-    LCD_SetPixel(x, y, state);
-  }
+  if (start_y >= 64)
+    return 1;   // Nothing on screen
   
-  return 1;
+  // Whole bytes down the column, RMW only for the end pages
+  return LCD_SetArea(x, start_y, x, end_y, state);
 }
 
 /*******************************************************************************
@@ -1350,7 +1549,6 @@ unsigned char LCD_DrawVLine(unsigned char x, unsigned char y1, unsigned char y2,
 *******************************************************************************/
 unsigned char LCD_FillRect(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state)
 {
-  unsigned char x, y;
   unsigned char start_x, end_x, start_y, end_y;
   
   // Ensure proper ordering
@@ -1380,19 +1578,8 @@ unsigned char LCD_FillRect(unsigned char x1, unsigned char y1, unsigned char x2,
   if (start_x >= 128 || start_y >= 64)
     return 0;
   
-  if (end_x >= 128) end_x = 127;
-  if (end_y >= 64) end_y = 63;
-  
-  // Fill rectangle
-  for (y = start_y; y <= end_y; y++)
-  {
-    for (x = start_x; x <= end_x; x++)
-    {
-      LCD_SetPixel(x, y, state);
-    }
-  }
-  
-  return 1;
+  // Page at a time instead of pixel at a time
+  return LCD_SetArea(start_x, start_y, end_x, end_y, state);
 }
 
 /*******************************************************************************
@@ -1551,23 +1738,20 @@ unsigned char LCD_FillTriangle(unsigned char x0, unsigned char y0,
 /*******************************************************************************
 * Function Name  : LCD_SetArea
 * Description    : Fast fill/clear a rectangular area (optimized for page mode)
-*                  Note: This is optimized for speed but less flexible than FillRect
-*                  Best used when y1 and y2 align with page boundaries (multiples of 8)
+*                  Whole pages are streamed; the partial top/bottom pages go
+*                  through read-modify-write mode, one pass per page
 * Input          : x1, y1 -- top-left corner
                    x2, y2 -- bottom-right corner
                    state -- 1: fill all pixels, 0: clear all pixels
 * Output         : None
 * Return         : 0 -- failure, 1 -- success
-* Warning        : For partial page boundaries, use LCD_FillRect instead for accuracy
 *******************************************************************************/
 unsigned char LCD_SetArea(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state)
 {
   unsigned char page_start, page_end, page;
   unsigned char x;
-  unsigned char mask_top, mask_bottom;
+  unsigned char mask;
   unsigned char data;
-  unsigned char col_high, col_low;
-  unsigned char current_data;
   
   // Boundary check
   if (x1 >= 128 || y1 >= 64)
@@ -1583,78 +1767,33 @@ unsigned char LCD_SetArea(unsigned char x1, unsigned char y1, unsigned char x2,
   page_start = y1 / 8;
   page_end = y2 / 8;
   
-  // Calculate masks for partial pages
-  mask_top = 0xFF << (y1 % 8);      // Top page: clear lower bits
-  mask_bottom = 0xFF >> (7 - (y2 % 8));  // Bottom page: clear upper bits
-  
-  // If same page, combine masks
-  if (page_start == page_end)
-  {
-    mask_top &= mask_bottom;
-    mask_bottom = 0;
-  }
-  
   data = state ? 0xFF : 0x00;
   
-  // Process each column
-  for (x = x1; x <= x2; x++)
+  // Process each page, one pass along the columns
+  for (page = page_start; page <= page_end; page++)
   {
-    col_high = x >> 4;
-    col_low = x & 0x0F;
+    mask = 0xFF;
+    if (page == page_start) mask &= 0xFF << (y1 % 8);       // Top page: clear lower bits
+    if (page == page_end) mask &= 0xFF >> (7 - (y2 % 8));   // Bottom page: clear upper bits
     
-    // Process each page
-    for (page = page_start; page <= page_end; page++)
+    if (mask == 0xFF)
     {
-      unsigned char write_data = data;
-      
-      // Apply masks for partial pages
-      if (page == page_start && (y1 % 8) != 0)
+      // Whole bytes - just stream them, the column auto-increments
+      LCD_SetAddress(page, x1);
+      for (x = x1; x <= x2; x++)
       {
-        // Need to read-modify-write for top boundary
-        LCD_Command = Set_Page_Addr_X | page;
-        delay();
-        LCD_Command = Set_ColH_Addr_X | col_high;
-        delay();
-        LCD_Command = Set_ColL_Addr_X | col_low;
-        delay();
-        
-        current_data = LCD_Data;  // Dummy read
-        delay();
-        current_data = LCD_Data;  // Actual read
-        delay();
-        
-        // Apply mask
-        write_data = (current_data & ~mask_top) | (data & mask_top);
+        LCD_WriteData(data);
       }
-      else if (page == page_end && (y2 % 8) != 7 && page_start != page_end)
+    }
+    else
+    {
+      // Partial page - keep the other rows with read-modify-write
+      LCD_RMW_Begin(page, x1);
+      for (x = x1; x <= x2; x++)
       {
-        // Need to read-modify-write for bottom boundary
-        LCD_Command = Set_Page_Addr_X | page;
-        delay();
-        LCD_Command = Set_ColH_Addr_X | col_high;
-        delay();
-        LCD_Command = Set_ColL_Addr_X | col_low;
-        delay();
-        
-        current_data = LCD_Data;  // Dummy read
-        delay();
-        current_data = LCD_Data;  // Actual read
-        delay();
-        
-        // Apply mask
-        write_data = (current_data & ~mask_bottom) | (data & mask_bottom);
+        LCD_RMW_Byte(mask, data);
       }
-      
-      // Write data
-      LCD_Command = Set_Page_Addr_X | page;
-      delay();
-      LCD_Command = Set_ColH_Addr_X | col_high;
-      delay();
-      LCD_Command = Set_ColL_Addr_X | col_low;
-      delay();
-      
-      LCD_Data = write_data;
-      delay();
+      LCD_RMW_End();
     }
   }
   
@@ -1672,9 +1811,55 @@ void LCD_Init(void)
 // DOUBLE BUFFERING SYSTEM IMPLEMENTATION
 // ============================================================================
 // Frame buffers - 128x64 LCD = 8 pages x 128 columns = 1024 bytes
-unsigned char frameBuffer[LCD_BUFFER_SIZE];      // Current frame (write here)
-unsigned char backBuffer[LCD_BUFFER_SIZE];       // Previous frame (for comparison)
+// Word aligned so the 32-bit loads in LCD_SwapBuffers() are single LDRs
+__ALIGN_BEGIN unsigned char frameBuffer[LCD_BUFFER_SIZE] __ALIGN_END;   // Current frame (write here)
+__ALIGN_BEGIN unsigned char backBuffer[LCD_BUFFER_SIZE] __ALIGN_END;    // Previous frame (for comparison)
 unsigned char dirtyPages[LCD_PAGES];             // Which pages need to be redrawn
+unsigned char dirtyColMin[LCD_PAGES];            // First written column per page (LCD_WIDTH = none)
+unsigned char dirtyColMax[LCD_PAGES];            // Last written column per page
+
+// Asynchronous flush state - runs queued by LCD_SwapBuffers()/LCD_FlushBuffer()
+// and sent one at a time from the DMA completion interrupt
+typedef struct {
+  unsigned char page;
+  unsigned char col;
+  unsigned char length;
+} LCD_Run;
+
+DMA_HandleTypeDef hdma_lcd;
+static LCD_Run lcdRunQueue[LCD_DMA_MAX_RUNS];
+static unsigned char lcdRunCount = 0;                     // Runs queued this flush
+static volatile unsigned char lcdRunHead = 0;             // Run currently on the bus
+static volatile unsigned char lcdFlushStatus = LCD_FLUSH_IDLE;
+static unsigned char lcdFlushMode = LCD_FLUSH_MODE_CPU;
+static void (*lcdFlushCallback)(void) = 0;
+
+// Run merging - LCD_SwapBuffers() holds back the last run of a page so the
+// next one can be appended to it when rewriting the gap is cheaper
+static unsigned int lcdCostCmd = LCD_COST_CMD_DEFAULT;
+static unsigned int lcdCostData = LCD_COST_DATA_DEFAULT;
+static unsigned int lcdCostDmaRun = LCD_COST_RUN_DMA_DEFAULT;
+static unsigned char lcdPendValid = 0;
+static unsigned char lcdPendPage, lcdPendCol, lcdPendEnd;   // Held run, end exclusive
+static unsigned char lcdRawPage, lcdRawCol;                 // Cursor if runs went out as found
+static unsigned char lcdOutPage, lcdOutCol;                 // Cursor after the merged runs
+static LCD_MergeStats lcdMergeStats;
+
+/*******************************************************************************
+* Function Name  : LCD_MarkDirtyCols
+* Description    : Mark a page dirty and widen its dirty column range, so the
+*                  flush only visits columns that were written
+* Input          : page -- page number (0-7)
+*                  first, last -- column range (first <= last < LCD_WIDTH)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_MarkDirtyCols(unsigned char page, unsigned char first, unsigned char last)
+{
+  dirtyPages[page] = 1;
+  if (first < dirtyColMin[page]) dirtyColMin[page] = first;
+  if (last > dirtyColMax[page]) dirtyColMax[page] = last;
+}
 
 /*******************************************************************************
 * Function Name  : LCD_InitFrameBuffer
@@ -1686,12 +1871,15 @@ unsigned char dirtyPages[LCD_PAGES];             // Which pages need to be redra
 void LCD_InitFrameBuffer(void)
 {
   unsigned int i;
+  LCD_WaitFlush();  // backBuffer may still be the DMA source
   for (i = 0; i < LCD_BUFFER_SIZE; i++) {
     frameBuffer[i] = 0;
     backBuffer[i] = 0;
   }
   for (i = 0; i < LCD_PAGES; i++) {
     dirtyPages[i] = 0;
+    dirtyColMin[i] = LCD_WIDTH;
+    dirtyColMax[i] = 0;
   }
 }
 
@@ -1710,7 +1898,7 @@ void LCD_ClearBuffer(void)
   }
   // Mark all pages dirty since we cleared
   for (i = 0; i < LCD_PAGES; i++) {
-    dirtyPages[i] = 1;
+    LCD_MarkDirtyCols(i, 0, LCD_WIDTH - 1);
   }
 }
 
@@ -1724,7 +1912,7 @@ void LCD_ClearBuffer(void)
 void LCD_MarkDirty(unsigned char page)
 {
   if (page < LCD_PAGES) {
-    dirtyPages[page] = 1;
+    LCD_MarkDirtyCols(page, 0, LCD_WIDTH - 1);
   }
 }
 
@@ -1745,233 +1933,1720 @@ void LCD_MarkDirtyRegion(unsigned char startPage, unsigned char endPage)
   }
   if (endPage >= LCD_PAGES) endPage = LCD_PAGES - 1;
   for (i = startPage; i <= endPage; i++) {
-    dirtyPages[i] = 1;
+    LCD_MarkDirtyCols(i, 0, LCD_WIDTH - 1);
   }
 }
 
 /*******************************************************************************
-* Function Name  : LCD_SwapBuffers
-* Description    : Compare frame buffer with back buffer and only update changed
-*                  columns. This is the key optimization - only sends data for
-*                  pixels that actually changed.
-* Input          : None
+* Function Name  : LCD_WriteRun
+* Description    : Write one run of backBuffer to the LCD with the CPU
+* Input          : page -- page number (0-7)
+*                  col -- column of the first byte
+*                  length -- number of bytes
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void LCD_SwapBuffers(void)
+static void LCD_WriteRun(unsigned char page, unsigned char col, unsigned char length)
 {
-  unsigned char page, col;
-  unsigned int offset;
-  unsigned char col_high, col_low;
-  unsigned char needsUpdate;
-  unsigned char startCol, endCol;
+  unsigned int offset = (unsigned int)page * LCD_WIDTH + col;
   
-  for (page = 0; page < LCD_PAGES; page++) {
-    // Skip pages that aren't dirty
-    if (!dirtyPages[page]) continue;
-    
-    // Find dirty columns within this page by comparing buffers
-    startCol = 255;  // Invalid value to detect "not found"
-    endCol = 0;
-    
-    for (col = 0; col < LCD_WIDTH; col++) {
-      offset = (unsigned int)page * LCD_WIDTH + col;
-      if (frameBuffer[offset] != backBuffer[offset]) {
-        if (startCol == 255) startCol = col;
-        endCol = col;
-      }
-    }
-    
-    // If no changes in this page, skip it
-    if (startCol == 255) {
-      dirtyPages[page] = 0;
-      continue;
-    }
-    
-    // Set page address once
-    LCD_Command = Set_Start_Line_X | 0x0;
-    LCD_Command = Set_Page_Addr_X | page;
-    
-    // Process dirty columns in batches for efficiency
-    col = startCol;
-    while (col <= endCol) {
-      // Find start of dirty region
-      offset = (unsigned int)page * LCD_WIDTH + col;
-      while (col <= endCol && frameBuffer[offset] == backBuffer[offset]) {
-        col++;
-        offset++;
-      }
-      
-      if (col > endCol) break;
-      
-      // Set column address for this region
-      col_high = col >> 4;
-      col_low = col & 0x0F;
-      LCD_Command = Set_ColH_Addr_X | col_high;
-      LCD_Command = Set_ColL_Addr_X | col_low;
-      
-      // Write consecutive dirty bytes
-      offset = (unsigned int)page * LCD_WIDTH + col;
-      while (col <= endCol && frameBuffer[offset] != backBuffer[offset]) {
-        LCD_Data = frameBuffer[offset];
-        backBuffer[offset] = frameBuffer[offset];  // Update back buffer
-        col++;
-        offset++;
-      }
-    }
-    
-    // Clear dirty flag for this page
-    dirtyPages[page] = 0;
+  LCD_SendAddress(page, col);
+  while (length--) {
+    LCD_WriteData(backBuffer[offset++]);
   }
 }
 
 /*******************************************************************************
-* Function Name  : LCD_FlushBuffer
-* Description    : Force flush entire frame buffer to LCD (use sparingly)
+* Function Name  : LCD_DMA_StartRun
+* Description    : Address the run at the head of the queue and hand its bytes
+*                  to the DMA channel. If the channel refuses, the rest of the
+*                  queue is written by the CPU.
 * Input          : None
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void LCD_FlushBuffer(void)
+static void LCD_DMA_StartRun(void)
 {
-  unsigned char page, col;
-  unsigned int offset;
-  
-  LCD_Command = Set_Start_Line_X | 0x0;
+  LCD_Run *run = &lcdRunQueue[lcdRunHead];
+  unsigned int offset = (unsigned int)run->page * LCD_WIDTH + run->col;
+  
+  LCD_SendAddress(run->page, run->col);
+  
+  if (HAL_DMA_Start_IT(&hdma_lcd, (uintptr_t)&backBuffer[offset], LCD_DATA_ADDR, run->length) == HAL_OK) {
+    // The DMA bytes bypass LCD_WriteData(), so advance the shadow here
+    lcdDmaInFlight = 1;
+    lcdTraffic.dataBytes += run->length;
+    lcdCurCol = run->col + run->length;
+    if (lcdCurCol > LCD_COL_LAST) lcdCurCol = LCD_COL_LAST;
+    return;
+  }
   
-  for (page = 0; page < LCD_PAGES; page++) {
-    LCD_Command = Set_Page_Addr_X | page;
-    LCD_Command = Set_ColH_Addr_X | 0x0;
-    LCD_Command = Set_ColL_Addr_X | 0x0;
-    
-    offset = (unsigned int)page * LCD_WIDTH;
-    for (col = 0; col < LCD_WIDTH; col++) {
-      LCD_Data = frameBuffer[offset + col];
-      backBuffer[offset + col] = frameBuffer[offset + col];
-    }
-    
-    dirtyPages[page] = 0;
+  // Fallback: finish the flush synchronously
+  for (; lcdRunHead < lcdRunCount; lcdRunHead++) {
+    run = &lcdRunQueue[lcdRunHead];
+    LCD_WriteRun(run->page, run->col, run->length);
   }
+  lcdFlushStatus = LCD_FLUSH_IDLE;
+  if (lcdFlushCallback) lcdFlushCallback();
 }
 
 /*******************************************************************************
-* Function Name  : LCD_Buffer_SetByte
-* Description    : Set a byte in the frame buffer at specific page/column
-* Input          : page -- page number (0-7)
-*                  col -- column position (0-127)
-*                  data -- byte to write
+* Function Name  : LCD_DMA_XferCplt
+* Description    : DMA transfer complete callback - start the next queued run
+*                  or report the flush as finished
+* Input          : hdma -- DMA handle (hdma_lcd)
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void LCD_Buffer_SetByte(unsigned char page, unsigned char col, unsigned char data)
+static void LCD_DMA_XferCplt(DMA_HandleTypeDef *hdma)
 {
-  unsigned int offset;
-  if (page >= LCD_PAGES || col >= LCD_WIDTH) return;
+  (void)hdma;
   
-  offset = (unsigned int)page * LCD_WIDTH + col;
-  if (frameBuffer[offset] != data) {
-    frameBuffer[offset] = data;
-    dirtyPages[page] = 1;
+  lcdDmaInFlight = 0;
+  if (++lcdRunHead < lcdRunCount) {
+    LCD_DMA_StartRun();
+    return;
   }
+  
+  lcdFlushStatus = LCD_FLUSH_IDLE;
+  if (lcdFlushCallback) lcdFlushCallback();
 }
 
 /*******************************************************************************
-* Function Name  : LCD_Buffer_DrawChar
-* Description    : Draw a character to the frame buffer (not directly to LCD)
-*                  Character is 8x16, so it spans 2 pages vertically
-* Input          : Xpage -- page position (0-6, since char is 2 pages tall)
-*                  YCol -- column position (0-127)
-*                  offset -- index in ChineseTable
+* Function Name  : LCD_DMA_XferError
+* Description    : DMA transfer error callback - resend the failed run and the
+*                  rest of the queue with the CPU
+* Input          : hdma -- DMA handle (hdma_lcd)
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void LCD_Buffer_DrawChar(unsigned char Xpage, unsigned char YCol, unsigned char offset)
+static void LCD_DMA_XferError(DMA_HandleTypeDef *hdma)
 {
-  unsigned char i;
-  unsigned int bufOffset;
-  unsigned char *c = ChineseTable[0] + 16 * offset;
-  
-  if (Xpage >= LCD_PAGES - 1 || YCol > LCD_WIDTH - 8) return;
+  LCD_Run *run;
   
-  // First 8 bytes go to first page
-  bufOffset = (unsigned int)Xpage * LCD_WIDTH + YCol;
-  for (i = 0; i < 8; i++) {
-    if (frameBuffer[bufOffset + i] != c[i]) {
-      frameBuffer[bufOffset + i] = c[i];
-      dirtyPages[Xpage] = 1;
-    }
-  }
+  (void)hdma;
   
-  // Next 8 bytes go to second page
-  bufOffset = (unsigned int)(Xpage + 1) * LCD_WIDTH + YCol;
-  for (i = 0; i < 8; i++) {
-    if (frameBuffer[bufOffset + i] != c[8 + i]) {
-      frameBuffer[bufOffset + i] = c[8 + i];
-      dirtyPages[Xpage + 1] = 1;
-    }
+  // Whatever reached the panel, the column counter is no longer known
+  lcdDmaInFlight = 0;
+  lcdCurCol = LCD_CURSOR_UNKNOWN;
+  for (; lcdRunHead < lcdRunCount; lcdRunHead++) {
+    run = &lcdRunQueue[lcdRunHead];
+    LCD_WriteRun(run->page, run->col, run->length);
   }
+  lcdFlushStatus = LCD_FLUSH_IDLE;
+  if (lcdFlushCallback) lcdFlushCallback();
 }
 
 /*******************************************************************************
-* Function Name  : LCD_Buffer_DrawString
-* Description    : Draw a string to the frame buffer
-* Input          : Xpage -- page position
-*                  YCol -- column position
-*                  c -- pointer to character indices array
-*                  length -- number of characters
+* Function Name  : LCD_DMA_Kick
+* Description    : Start sending the queued runs, if any
+* Input          : None
 * Output         : None
-* Return         : 0 -- failure, 1 -- success
+* Return         : None
 *******************************************************************************/
-unsigned char LCD_Buffer_DrawString(unsigned char Xpage, unsigned char YCol, unsigned char *c, unsigned char length)
+static void LCD_DMA_Kick(void)
 {
-  unsigned char len = length;
-  unsigned char* pOffset = c;
+  if (lcdRunCount == 0) {
+    if (lcdFlushCallback) lcdFlushCallback();
+    return;
+  }
   
-  if ((LCD_WIDTH - YCol) < 8 * length)
-    return 0;
+  lcdRunHead = 0;
+  lcdFlushStatus = LCD_FLUSH_BUSY;
+  LCD_SendStartLine(0);
+  LCD_DMA_StartRun();
+}
+
+/*******************************************************************************
+* Function Name  : LCD_InitDMA
+* Description    : Configure DMA2 channel 1 to push runs into LCD_Data.
+*                  The FSMC has no DMA request line, so this is a memory-to-
+*                  memory transfer: the source (backBuffer) sits in CPAR and
+*                  increments, the destination (LCD_DATA_ADDR) sits in CMAR and
+*                  stays fixed.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_InitDMA(void)
+{
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  
+  hdma_lcd.Instance = DMA2_Channel1;
+  hdma_lcd.Init.Direction = DMA_MEMORY_TO_MEMORY;
+  hdma_lcd.Init.PeriphInc = DMA_PINC_ENABLE;
+  hdma_lcd.Init.MemInc = DMA_MINC_DISABLE;
+  hdma_lcd.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_lcd.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_lcd.Init.Mode = DMA_NORMAL;
+  hdma_lcd.Init.Priority = DMA_PRIORITY_LOW;
+  HAL_DMA_Init(&hdma_lcd);
+  
+  hdma_lcd.XferCpltCallback = LCD_DMA_XferCplt;
+  hdma_lcd.XferErrorCallback = LCD_DMA_XferError;
+  
+  HAL_NVIC_SetPriority(DMA2_Channel1_IRQn, 2, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Channel1_IRQn);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SetFlushMode
+* Description    : Select how LCD_SwapBuffers()/LCD_FlushBuffer() send data
+* Input          : mode -- LCD_FLUSH_MODE_CPU or LCD_FLUSH_MODE_DMA
+*                  (LCD_InitDMA() must have been called for DMA mode)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_SetFlushMode(unsigned char mode)
+{
+  LCD_WaitFlush();
+  lcdFlushMode = mode;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetFlushStatus
+* Description    : Report whether a DMA flush is still going out
+* Input          : None
+* Output         : None
+* Return         : LCD_FLUSH_IDLE or LCD_FLUSH_BUSY
+*******************************************************************************/
+unsigned char LCD_GetFlushStatus(void)
+{
+  return lcdFlushStatus;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_WaitFlush
+* Description    : Block until the previous flush has been fully sent
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_WaitFlush(void)
+{
+  while (lcdFlushStatus != LCD_FLUSH_IDLE) {
+#ifdef HOST_BUILD
+    // No interrupts on the host - retire the in-flight transfer here
+    LCD_Host_DMA_Complete();
+#endif
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SetFlushCallback
+* Description    : Register a function called when a flush has been sent.
+*                  In DMA mode it runs in interrupt context.
+* Input          : callback -- function to call, or 0 to disable
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_SetFlushCallback(void (*callback)(void))
+{
+  lcdFlushCallback = callback;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetAddrCmdsSaved
+* Description    : Address/start line commands the shadow cursor left out since
+*                  the last LCD_SwapBuffers()/LCD_FlushBuffer() started. In DMA
+*                  mode the count is final once the flush is idle.
+* Input          : None
+* Output         : None
+* Return         : Number of commands not sent
+*******************************************************************************/
+unsigned int LCD_GetAddrCmdsSaved(void)
+{
+  return lcdAddrCmdsSaved;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetAddrCmdsSent
+* Description    : Address/start line commands actually sent over the same span
+* Input          : None
+* Output         : None
+* Return         : Number of commands sent
+*******************************************************************************/
+unsigned int LCD_GetAddrCmdsSent(void)
+{
+  return lcdAddrCmdsSent;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SetFlushCostModel
+* Description    : Set the costs LCD_SwapBuffers() weighs when deciding whether
+*                  to merge two runs across an unchanged gap. Any unit works as
+*                  long as all three use the same one (defaults: HCLK cycles).
+* Input          : cmdCost -- one command byte
+*                  dataCost -- one data byte
+*                  dmaRunCost -- extra cost of one more DMA run (IRQ + restart)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_SetFlushCostModel(unsigned int cmdCost, unsigned int dataCost, unsigned int dmaRunCost)
+{
+  lcdCostCmd = cmdCost;
+  lcdCostData = dataCost;
+  lcdCostDmaRun = dmaRunCost;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetMergeStats
+* Description    : Copy the run merging totals since the last reset
+* Input          : stats -- destination
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_GetMergeStats(LCD_MergeStats *stats)
+{
+  *stats = lcdMergeStats;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_ResetMergeStats
+* Description    : Zero the run merging totals
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_ResetMergeStats(void)
+{
+  lcdMergeStats.frames = 0;
+  lcdMergeStats.runsBefore = 0;
+  lcdMergeStats.runsAfter = 0;
+  lcdMergeStats.busBytesBefore = 0;
+  lcdMergeStats.busBytesAfter = 0;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetLastTraffic
+* Description    : Bus traffic of the last recorded frame (from one swap/flush
+*                  to the next)
+* Input          : traffic -- destination
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_GetLastTraffic(LCD_FrameTraffic *traffic)
+{
+  *traffic = lcdTrafficLast;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GetTrafficStats
+* Description    : Copy the per-frame traffic histograms
+* Input          : stats -- destination
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_GetTrafficStats(LCD_TrafficStats *stats)
+{
+  *stats = lcdTrafficStats;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_ResetTrafficStats
+* Description    : Zero the traffic histograms
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_ResetTrafficStats(void)
+{
+  unsigned char m, b;
   
-  while (len--) {
-    LCD_Buffer_DrawChar(Xpage, YCol, *pOffset);
-    YCol += 8;
-    pOffset++;
+  lcdTrafficStats.frames = 0;
+  for (m = 0; m < LCD_TRAFFIC_METRICS; m++) {
+    lcdTrafficStats.max[m] = 0;
+    for (b = 0; b < LCD_TRAFFIC_BINS; b++) {
+      lcdTrafficStats.hist[m][b] = 0;
+    }
   }
-  return 1;
 }
 
 /*******************************************************************************
-* Function Name  : LCD_Buffer_ClearArea
-* Description    : Clear an area in the frame buffer
-* Input          : page -- starting page (clears this and next page for 16x sprite)
-*                  col -- starting column
-*                  width -- width in columns (8 per character)
+* Function Name  : LCD_DumpTrafficStats
+* Description    : Write the traffic histograms as text, one line per metric:
+*                    data max=412 0:3 64:120 128:400
+*                  Each pair is the lowest value of a bin and its frame count;
+*                  empty bins are left out. A last line gives the run merging
+*                  totals, found -> sent:
+*                    merge frames=600 runs=810>652 bus=9120>8790
+* Input          : write -- called once per line (e.g. a UART transmit)
 * Output         : None
 * Return         : None
 *******************************************************************************/
-void LCD_Buffer_ClearArea(unsigned char page, unsigned char col, unsigned char width)
+void LCD_DumpTrafficStats(void (*write)(const char *text, unsigned int length))
 {
-  unsigned char i;
-  unsigned int bufOffset;
+  static const char *names[LCD_TRAFFIC_METRICS] = { "cmd", "data", "pages", "runs", "readdr" };
+  char line[24 + LCD_TRAFFIC_BINS * 16];
+  unsigned int pos;
+  unsigned char m, b;
+  unsigned long low;
+  
+  pos = Fmt_AppendText(line, 0, "LCD traffic frames=");
+  pos = Fmt_AppendUInt(line, pos, lcdTrafficStats.frames);
+  pos = Fmt_AppendText(line, pos, "\r\n");
+  write(line, pos);
+  
+  for (m = 0; m < LCD_TRAFFIC_METRICS; m++) {
+    pos = Fmt_AppendText(line, 0, names[m]);
+    pos = Fmt_AppendText(line, pos, " max=");
+    pos = Fmt_AppendUInt(line, pos, lcdTrafficStats.max[m]);
+    for (b = 0; b < LCD_TRAFFIC_BINS; b++) {
+      if (lcdTrafficStats.hist[m][b] == 0) continue;
+      if (m == LCD_TRAFFIC_PAGES || b == 0) low = b;
+      else low = 1UL << (b - 1);
+      line[pos++] = ' ';
+      pos = Fmt_AppendUInt(line, pos, low);
+      line[pos++] = ':';
+      pos = Fmt_AppendUInt(line, pos, lcdTrafficStats.hist[m][b]);
+    }
+    pos = Fmt_AppendText(line, pos, "\r\n");
+    write(line, pos);
+  }
   
-  if (page >= LCD_PAGES || col >= LCD_WIDTH) return;
-  if (col + width * 8 > LCD_WIDTH) width = (LCD_WIDTH - col) / 8;
+  pos = Fmt_AppendText(line, 0, "merge frames=");
+  pos = Fmt_AppendUInt(line, pos, lcdMergeStats.frames);
+  pos = Fmt_AppendText(line, pos, " runs=");
+  pos = Fmt_AppendUInt(line, pos, lcdMergeStats.runsBefore);
+  line[pos++] = '>';
+  pos = Fmt_AppendUInt(line, pos, lcdMergeStats.runsAfter);
+  pos = Fmt_AppendText(line, pos, " bus=");
+  pos = Fmt_AppendUInt(line, pos, lcdMergeStats.busBytesBefore);
+  line[pos++] = '>';
+  pos = Fmt_AppendUInt(line, pos, lcdMergeStats.busBytesAfter);
+  pos = Fmt_AppendText(line, pos, "\r\n");
+  write(line, pos);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_EmitRun
+* Description    : Hand one run of changed bytes (already copied into
+*                  backBuffer) to the DMA queue, or write it with the CPU in
+*                  CPU mode / when the queue is full
+* Input          : page -- page number (0-7)
+*                  col -- first column of the run
+*                  length -- number of bytes
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_EmitRun(unsigned char page, unsigned char col, unsigned char length)
+{
+  lcdTraffic.runs++;
+  if (lcdFlushMode == LCD_FLUSH_MODE_DMA && lcdRunCount < LCD_DMA_MAX_RUNS) {
+    lcdRunQueue[lcdRunCount].page = page;
+    lcdRunQueue[lcdRunCount].col = col;
+    lcdRunQueue[lcdRunCount].length = length;
+    lcdRunCount++;
+    return;
+  }
   
-  // Clear first page
-  bufOffset = (unsigned int)page * LCD_WIDTH + col;
-  for (i = 0; i < width * 8 && (col + i) < LCD_WIDTH; i++) {
-    if (frameBuffer[bufOffset + i] != 0) {
-      frameBuffer[bufOffset + i] = 0;
-      dirtyPages[page] = 1;
+  // Nothing is in flight during the diff, so the CPU can write it now
+  LCD_SendStartLine(0);
+  LCD_WriteRun(page, col, length);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_TrafficBin
+* Description    : Histogram bin of a per-frame count. Dirty pages get one bin
+*                  per value; the byte/run counts use power-of-two bins
+*                  (0, 1, 2-3, 4-7, ...), the last one open-ended.
+* Input          : metric -- LCD_TRAFFIC_* index
+*                  value -- count for one frame
+* Output         : None
+* Return         : Bin index (0 to LCD_TRAFFIC_BINS-1)
+*******************************************************************************/
+static unsigned char LCD_TrafficBin(unsigned char metric, unsigned int value)
+{
+  unsigned char bin = 0;
+  
+  if (metric == LCD_TRAFFIC_PAGES) {
+    return value < LCD_TRAFFIC_BINS ? value : LCD_TRAFFIC_BINS - 1;
+  }
+  while (value && bin < LCD_TRAFFIC_BINS - 1) {
+    value >>= 1;
+    bin++;
+  }
+  return bin;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_BeginFrameTraffic
+* Description    : Record the frame counted so far into the histograms and
+*                  start a new one. Called by LCD_SwapBuffers()/
+*                  LCD_FlushBuffer() once the previous flush is out.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_BeginFrameTraffic(void)
+{
+  unsigned int value[LCD_TRAFFIC_METRICS];
+  unsigned char m;
+  
+  if (lcdTrafficOpen) {
+    value[LCD_TRAFFIC_CMD] = lcdTraffic.cmdBytes;
+    value[LCD_TRAFFIC_DATA] = lcdTraffic.dataBytes;
+    value[LCD_TRAFFIC_PAGES] = lcdTraffic.dirtyPages;
+    value[LCD_TRAFFIC_RUNS] = lcdTraffic.runs;
+    value[LCD_TRAFFIC_READDR] = lcdTraffic.reAddr;
+    
+    for (m = 0; m < LCD_TRAFFIC_METRICS; m++) {
+      lcdTrafficStats.hist[m][LCD_TrafficBin(m, value[m])]++;
+      if (value[m] > lcdTrafficStats.max[m]) lcdTrafficStats.max[m] = value[m];
     }
+    lcdTrafficStats.frames++;
+    lcdTrafficLast = lcdTraffic;
   }
   
-  // Clear second page if valid
-  if (page + 1 < LCD_PAGES) {
-    bufOffset = (unsigned int)(page + 1) * LCD_WIDTH + col;
-    for (i = 0; i < width * 8 && (col + i) < LCD_WIDTH; i++) {
-      if (frameBuffer[bufOffset + i] != 0) {
-        frameBuffer[bufOffset + i] = 0;
-        dirtyPages[page + 1] = 1;
+  lcdTraffic.cmdBytes = 0;
+  lcdTraffic.dataBytes = 0;
+  lcdTraffic.dirtyPages = 0;
+  lcdTraffic.runs = 0;
+  lcdTraffic.reAddr = 0;
+  lcdTrafficOpen = 1;
+  
+  lcdAddrCmdsSent = 0;
+  lcdAddrCmdsSaved = 0;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_AddrCmdCount
+* Description    : Number of address commands needed to move the controller
+*                  cursor from one position to another
+* Input          : fromPage, fromCol -- current cursor (LCD_CURSOR_UNKNOWN ok)
+*                  page, col -- target
+* Output         : None
+* Return         : 0 to 3
+*******************************************************************************/
+static unsigned char LCD_AddrCmdCount(unsigned char fromPage, unsigned char fromCol,
+                                      unsigned char page, unsigned char col)
+{
+  unsigned char n = 0;
+  
+  if (fromPage != page) n++;
+  if (fromCol == LCD_CURSOR_UNKNOWN || (fromCol >> 4) != (col >> 4)) n++;
+  if (fromCol == LCD_CURSOR_UNKNOWN || (fromCol & 0x0F) != (col & 0x0F)) n++;
+  return n;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_FlushPendingRun
+* Description    : Emit the run held back for merging, if any
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_FlushPendingRun(void)
+{
+  if (!lcdPendValid) return;
+  
+  lcdMergeStats.runsAfter++;
+  lcdMergeStats.busBytesAfter += LCD_AddrCmdCount(lcdOutPage, lcdOutCol, lcdPendPage, lcdPendCol)
+                               + (lcdPendEnd - lcdPendCol);
+  lcdOutPage = lcdPendPage;
+  lcdOutCol = lcdPendEnd;
+  
+  LCD_EmitRun(lcdPendPage, lcdPendCol, lcdPendEnd - lcdPendCol);
+  lcdPendValid = 0;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_QueueRun
+* Description    : Add a run of changed bytes found by the diff. If it follows
+*                  the held run on the same page and resending the unchanged
+*                  gap costs less than re-addressing (plus a DMA restart in
+*                  DMA mode), the two are merged.
+* Input          : page -- page number (0-7)
+*                  col -- first column of the run
+*                  length -- number of bytes
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_QueueRun(unsigned char page, unsigned char col, unsigned char length)
+{
+  unsigned int skipCost;
+  
+  // What this run would cost sent as found
+  lcdMergeStats.runsBefore++;
+  lcdMergeStats.busBytesBefore += LCD_AddrCmdCount(lcdRawPage, lcdRawCol, page, col) + length;
+  lcdRawPage = page;
+  lcdRawCol = col + length;
+  
+  if (lcdPendValid && lcdPendPage == page) {
+    skipCost = LCD_AddrCmdCount(page, lcdPendEnd, page, col) * lcdCostCmd;
+    if (lcdFlushMode == LCD_FLUSH_MODE_DMA) skipCost += lcdCostDmaRun;
+    
+    // Gap bytes are unchanged, so backBuffer already holds what the panel shows
+    if ((unsigned int)(col - lcdPendEnd) * lcdCostData < skipCost) {
+      lcdPendEnd = col + length;
+      return;
+    }
+  }
+  
+  LCD_FlushPendingRun();
+  lcdPendPage = page;
+  lcdPendCol = col;
+  lcdPendEnd = col + length;
+  lcdPendValid = 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_SwapBuffers
+* Description    : Compare frame buffer with back buffer and only update changed
+*                  columns. This is the key optimization - only sends data for
+*                  pixels that actually changed. Only the column range the
+*                  writers recorded in dirtyColMin/dirtyColMax is compared,
+*                  one 32-bit word at a time; bytes are only looked at inside
+*                  words that differ.
+*                  In DMA mode the changed runs are queued and this returns as
+*                  soon as the first transfer has started.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_SwapBuffers(void)
+{
+  unsigned char page, b;
+  unsigned char col, runCol, inRun;
+  unsigned int word, lastWord, offset;
+  uint32_t frameWord, backWord;
+  
+  // Previous flush must be out before backBuffer and the queue are reused
+  LCD_WaitFlush();
+  LCD_BeginFrameTraffic();
+  lcdRunCount = 0;
+  
+  // Both cost estimates start from where the controller cursor really is
+  lcdPendValid = 0;
+  lcdRawPage = lcdOutPage = lcdCurPage;
+  lcdRawCol = lcdOutCol = lcdCurCol;
+  lcdMergeStats.frames++;
+  
+  for (page = 0; page < LCD_PAGES; page++) {
+    // Skip pages that aren't dirty
+    if (!dirtyPages[page]) continue;
+    lcdTraffic.dirtyPages++;
+    
+    // Word range covering the written columns. Bytes outside the recorded
+    // range but inside its edge words were not written, so they compare equal.
+    word = (unsigned int)page * (LCD_WIDTH / 4) + dirtyColMin[page] / 4;
+    lastWord = (unsigned int)page * (LCD_WIDTH / 4) + dirtyColMax[page] / 4;
+    inRun = 0;
+    runCol = 0;
+    
+    // Single pass: runs are emitted as soon as their end is found
+    for (; word <= lastWord; word++) {
+      // memcpy rather than a uint32_t * cast, which would break strict
+      // aliasing; GCC turns each one into a single load
+      memcpy(&frameWord, frameBuffer + 4 * word, 4);
+      memcpy(&backWord, backBuffer + 4 * word, 4);
+      if (frameWord == backWord) {
+        if (inRun) {
+          col = (word % (LCD_WIDTH / 4)) * 4;
+          LCD_QueueRun(page, runCol, col - runCol);
+          inRun = 0;
+        }
+        continue;
+      }
+      
+      // Word differs: fall back to bytes, copying changed ones to the back
+      // buffer (which is also what gets sent)
+      offset = (unsigned int)word * 4;
+      col = (word % (LCD_WIDTH / 4)) * 4;
+      for (b = 0; b < 4; b++, offset++, col++) {
+        if (frameBuffer[offset] != backBuffer[offset]) {
+          backBuffer[offset] = frameBuffer[offset];
+          if (!inRun) {
+            runCol = col;
+            inRun = 1;
+          }
+        } else if (inRun) {
+          LCD_QueueRun(page, runCol, col - runCol);
+          inRun = 0;
+        }
       }
     }
+    if (inRun) {
+      LCD_QueueRun(page, runCol, col - runCol);  // col is one past lastWord
+    }
+    
+    // Clear dirty flag and column range for this page
+    dirtyPages[page] = 0;
+    dirtyColMin[page] = LCD_WIDTH;
+    dirtyColMax[page] = 0;
+  }
+  LCD_FlushPendingRun();
+  
+  if (lcdFlushMode == LCD_FLUSH_MODE_DMA) {
+    LCD_DMA_Kick();
+  } else if (lcdFlushCallback) {
+    lcdFlushCallback();
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_FlushBuffer
+* Description    : Force flush entire frame buffer to LCD (use sparingly)
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_FlushBuffer(void)
+{
+  unsigned char page, col;
+  unsigned int offset;
+  
+  LCD_WaitFlush();
+  LCD_BeginFrameTraffic();
+  lcdRunCount = 0;
+  lcdTraffic.dirtyPages = LCD_PAGES;
+  lcdTraffic.runs = LCD_PAGES;              // One full-page run each
+  
+  if (lcdFlushMode == LCD_FLUSH_MODE_CPU) {
+    LCD_SendStartLine(0);
+  }
+  
+  for (page = 0; page < LCD_PAGES; page++) {
+    offset = (unsigned int)page * LCD_WIDTH;
+    for (col = 0; col < LCD_WIDTH; col++) {
+      backBuffer[offset + col] = frameBuffer[offset + col];
+    }
+    
+    if (lcdFlushMode == LCD_FLUSH_MODE_DMA) {
+      // One full-page run per page
+      lcdRunQueue[lcdRunCount].page = page;
+      lcdRunQueue[lcdRunCount].col = 0;
+      lcdRunQueue[lcdRunCount].length = LCD_WIDTH;
+      lcdRunCount++;
+    } else {
+      LCD_WriteRun(page, 0, LCD_WIDTH);
+    }
+    
+    dirtyPages[page] = 0;
+    dirtyColMin[page] = LCD_WIDTH;
+    dirtyColMax[page] = 0;
   }
+  
+  if (lcdFlushMode == LCD_FLUSH_MODE_DMA) {
+    LCD_DMA_Kick();
+  } else if (lcdFlushCallback) {
+    lcdFlushCallback();
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_SetByte
+* Description    : Set a byte in the frame buffer at specific page/column
+* Input          : page -- page number (0-7)
+*                  col -- column position (0-127)
+*                  data -- byte to write
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_SetByte(unsigned char page, unsigned char col, unsigned char data)
+{
+  unsigned int offset;
+  if (page >= LCD_PAGES || col >= LCD_WIDTH) return;
+  
+  offset = (unsigned int)page * LCD_WIDTH + col;
+  if (frameBuffer[offset] != data) {
+    frameBuffer[offset] = data;
+    LCD_MarkDirtyCols(page, col, col);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawChar
+* Description    : Draw a character to the frame buffer (not directly to LCD)
+*                  Character is 8x16, so it spans 2 pages vertically
+* Input          : Xpage -- page position (0-6, since char is 2 pages tall)
+*                  YCol -- column position (0-127)
+*                  offset -- index in ChineseTable
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_DrawChar(unsigned char Xpage, unsigned char YCol, unsigned char offset)
+{
+  unsigned char i;
+  unsigned int bufOffset;
+  unsigned char *c = ChineseTable[0] + 16 * offset;
+  
+  if (Xpage >= LCD_PAGES - 1 || YCol > LCD_WIDTH - 8) return;
+  
+  // First 8 bytes go to first page
+  bufOffset = (unsigned int)Xpage * LCD_WIDTH + YCol;
+  for (i = 0; i < 8; i++) {
+    if (frameBuffer[bufOffset + i] != c[i]) {
+      frameBuffer[bufOffset + i] = c[i];
+      LCD_MarkDirtyCols(Xpage, YCol + i, YCol + i);
+    }
+  }
+  
+  // Next 8 bytes go to second page
+  bufOffset = (unsigned int)(Xpage + 1) * LCD_WIDTH + YCol;
+  for (i = 0; i < 8; i++) {
+    if (frameBuffer[bufOffset + i] != c[8 + i]) {
+      frameBuffer[bufOffset + i] = c[8 + i];
+      LCD_MarkDirtyCols(Xpage + 1, YCol + i, YCol + i);
+    }
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawString
+* Description    : Draw a string to the frame buffer
+* Input          : Xpage -- page position
+*                  YCol -- column position
+*                  c -- pointer to character indices array
+*                  length -- number of characters
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawString(unsigned char Xpage, unsigned char YCol, unsigned char *c, unsigned char length)
+{
+  unsigned char len = length;
+  unsigned char* pOffset = c;
+  
+  if ((LCD_WIDTH - YCol) < 8 * length)
+    return 0;
+  
+  while (len--) {
+    LCD_Buffer_DrawChar(Xpage, YCol, *pOffset);
+    YCol += 8;
+    pOffset++;
+  }
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_ClearArea
+* Description    : Clear an area in the frame buffer
+* Input          : page -- starting page (clears this and next page for 16x sprite)
+*                  col -- starting column
+*                  width -- width in columns (8 per character)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_ClearArea(unsigned char page, unsigned char col, unsigned char width)
+{
+  unsigned char i;
+  unsigned int bufOffset;
+  
+  if (page >= LCD_PAGES || col >= LCD_WIDTH) return;
+  if (col + width * 8 > LCD_WIDTH) width = (LCD_WIDTH - col) / 8;
+  
+  // Clear first page
+  bufOffset = (unsigned int)page * LCD_WIDTH + col;
+  for (i = 0; i < width * 8 && (col + i) < LCD_WIDTH; i++) {
+    if (frameBuffer[bufOffset + i] != 0) {
+      frameBuffer[bufOffset + i] = 0;
+      LCD_MarkDirtyCols(page, col + i, col + i);
+    }
+  }
+  
+  // Clear second page if valid
+  if (page + 1 < LCD_PAGES) {
+    bufOffset = (unsigned int)(page + 1) * LCD_WIDTH + col;
+    for (i = 0; i < width * 8 && (col + i) < LCD_WIDTH; i++) {
+      if (frameBuffer[bufOffset + i] != 0) {
+        frameBuffer[bufOffset + i] = 0;
+        LCD_MarkDirtyCols(page + 1, col + i, col + i);
+      }
+    }
+  }
+}
+
+// ============================================================================
+// BUFFERED PIXEL/SHAPE PRIMITIVES
+// ============================================================================
+// Same shapes as the direct LCD_SetPixel() family, but every pixel is a masked
+// read-modify-write of frameBuffer instead of three FSMC round trips.
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_ApplyMask
+* Description    : Set or clear the masked bits of one frame buffer byte and
+*                  mark its page dirty if it changed
+* Input          : page -- page number (0-7)
+*                  col -- column position (0-127)
+*                  mask -- bits to change
+*                  state -- 1: set bits, 0: clear bits
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_Buffer_ApplyMask(unsigned char page, unsigned char col, unsigned char mask, unsigned char state)
+{
+  unsigned int offset = (unsigned int)page * LCD_WIDTH + col;
+  unsigned char data = state ? (frameBuffer[offset] | mask) : (frameBuffer[offset] & ~mask);
+  
+  if (frameBuffer[offset] != data) {
+    frameBuffer[offset] = data;
+    LCD_MarkDirtyCols(page, col, col);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_Plot
+* Description    : Set or clear one pixel, silently clipped to the screen
+* Input          : x, y -- pixel coordinates (may be off screen)
+*                  state -- 1: set, 0: clear
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_Buffer_Plot(signed short x, signed short y, unsigned char state)
+{
+  if (x < 0 || x >= LCD_WIDTH || y < 0 || y >= LCD_HEIGHT) return;
+  LCD_Buffer_ApplyMask(y >> 3, x, 1 << (y & 7), state);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_Span
+* Description    : Horizontal run of pixels, clipped to the screen. One page
+*                  and one bit mask for the whole run.
+* Input          : x1, x2 -- start and end x (x1 <= x2, may be off screen)
+*                  y -- row
+*                  state -- 1: set, 0: clear
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_Buffer_Span(signed short x1, signed short x2, signed short y, unsigned char state)
+{
+  unsigned char page, mask;
+  
+  if (y < 0 || y >= LCD_HEIGHT) return;
+  if (x1 < 0) x1 = 0;
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH - 1;
+  
+  page = y >> 3;
+  mask = 1 << (y & 7);
+  for (; x1 <= x2; x1++) {
+    LCD_Buffer_ApplyMask(page, x1, mask, state);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_Fill
+* Description    : Fill or clear an on-screen rectangle page by page, so each
+*                  touched byte is updated once with a combined mask
+* Input          : x1, x2 -- column range (x1 <= x2, both < 128)
+*                  y1, y2 -- row range (y1 <= y2, both < 64)
+*                  state -- 1: set, 0: clear
+* Output         : None
+* Return         : None
+*******************************************************************************/
+static void LCD_Buffer_Fill(unsigned char x1, unsigned char x2, unsigned char y1, unsigned char y2, unsigned char state)
+{
+  unsigned char page, mask, x;
+  unsigned char page_start = y1 / 8;
+  unsigned char page_end = y2 / 8;
+  
+  for (page = page_start; page <= page_end; page++) {
+    mask = 0xFF;
+    if (page == page_start) mask &= 0xFF << (y1 % 8);       // Top page: clear lower bits
+    if (page == page_end)   mask &= 0xFF >> (7 - (y2 % 8)); // Bottom page: clear upper bits
+    
+    for (x = x1; x <= x2; x++) {
+      LCD_Buffer_ApplyMask(page, x, mask, state);
+    }
+  }
+}
+
+// ============================================================================
+// SUB-PAGE GLYPH BLITTER
+// ============================================================================
+// A glyph drawn at pixel row r covers pages r/8 .. r/8 + 2: each of its 8
+// columns is the 16-bit glyph column shifted down by r % 8, split into three
+// bytes. Glyphs registered with LCD_GlyphCache_Add() have those bytes worked
+// out for all 8 shifts once, so drawing them is three table reads and ORs per
+// column. Host/sprite_bench times a cached glyph at about 1.1-1.2x the
+// page-aligned LCD_Buffer_DrawChar() and an uncached one at about 1.3x.
+//
+// Each byte is combined with the buffer by a raster op (LCD_ROP_*), limited
+// to a transparency mask in the same 16-byte layout as the glyph: outside the
+// mask the buffer is left as it is. Erasing puts back the background layer,
+// a copy of the static scenery taken with LCD_Background_Capture(), instead
+// of writing zeros, so a sprite passing over the scenery does not wipe it.
+
+static unsigned char backgroundBuffer[LCD_BUFFER_SIZE];   // Static scenery under the sprites
+static const unsigned char lcdSolid[8][3] = {             // No mask: every sprite bit counts
+  {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF},
+  {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF}
+};
+
+#if LCD_GLYPH_CACHE_SLOTS > 0
+static unsigned char glyphCacheCount = 0;
+static unsigned char glyphCacheSlot[256];   // ChineseTable index -> slot + 1, 0 -- not cached
+static unsigned char glyphCache[LCD_GLYPH_CACHE_SLOTS][8][8][3];  // [slot][shift][column][page]
+#endif
+
+/*******************************************************************************
+* Function Name  : LCD_ShiftGlyph
+* Description    : Split an 8x16 glyph shifted down by 0-7 rows into the three
+*                  page bytes of each column
+* Input          : glyph -- 16 ChineseTable bytes (top page, then bottom page)
+*                  shift -- rows below the page boundary (0-7)
+* Output         : out -- [column][page]
+* Return         : None
+*******************************************************************************/
+static void LCD_ShiftGlyph(const unsigned char *glyph, unsigned char shift, unsigned char out[8][3])
+{
+  unsigned char i;
+  
+  for (i = 0; i < 8; i++) {
+    uint32_t bits = ((uint32_t)glyph[i] | ((uint32_t)glyph[8 + i] << 8)) << shift;
+    out[i][0] = (unsigned char)bits;
+    out[i][1] = (unsigned char)(bits >> 8);
+    out[i][2] = (unsigned char)(bits >> 16);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GlyphColumns
+* Description    : The three page bytes of each column of a glyph shifted down
+*                  by 0-7 rows: from the cache if the glyph is in it, else
+*                  worked out into the caller's array
+* Input          : offset -- index in ChineseTable
+*                  shift -- rows below the page boundary (0-7)
+*                  out -- scratch for an uncached glyph
+* Output         : None
+* Return         : [column][page] bytes
+*******************************************************************************/
+static const unsigned char (*LCD_GlyphColumns(unsigned char offset, unsigned char shift, unsigned char out[8][3]))[3]
+{
+#if LCD_GLYPH_CACHE_SLOTS > 0
+  if (glyphCacheSlot[offset]) {
+    return (const unsigned char (*)[3])glyphCache[glyphCacheSlot[offset] - 1][shift];
+  }
+#endif
+  LCD_ShiftGlyph(ChineseTable[offset], shift, out);
+  return (const unsigned char (*)[3])out;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_GlyphCache_Add
+* Description    : Pre-shift a glyph for every row offset, so the sub-page
+*                  blitter draws it from the table. Call at startup for the
+*                  sprites drawn every frame.
+* Input          : offset -- index in ChineseTable
+* Output         : None
+* Return         : 0 -- not cached (no free slot, or LCD_GLYPH_CACHE_SLOTS 0)
+*                  1 -- cached (now or already)
+*******************************************************************************/
+unsigned char LCD_GlyphCache_Add(unsigned char offset)
+{
+#if LCD_GLYPH_CACHE_SLOTS > 0
+  unsigned char shift;
+  
+  if (glyphCacheSlot[offset]) return 1;
+  if (glyphCacheCount >= LCD_GLYPH_CACHE_SLOTS) return 0;
+  for (shift = 0; shift < 8; shift++) {
+    LCD_ShiftGlyph(ChineseTable[offset], shift, glyphCache[glyphCacheCount][shift]);
+  }
+  glyphCacheSlot[offset] = ++glyphCacheCount;
+  return 1;
+#else
+  (void)offset;
+  return 0;
+#endif
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_BlitGlyph
+* Description    : Combine an 8x16 ChineseTable glyph with the frame buffer,
+*                  its top at any pixel row. The glyph lands on two pages when
+*                  the row is page-aligned, three otherwise; rows below the
+*                  screen are dropped. Columns left of 0 or right of 127 are
+*                  clipped, so a sprite can slide in and out at the edges one
+*                  pixel at a time; nothing outside the visible columns is
+*                  touched. Each page is marked dirty once, over the columns
+*                  that actually changed.
+* Input          : row -- top pixel row (0-63)
+*                  col -- column of the glyph's left edge (-7 to 127 visible)
+*                  offset -- index in ChineseTable
+*                  mask -- 16 bytes in glyph layout, 1 = opaque; NULL -- the
+*                          whole 8x16 cell for LCD_ROP_COPY, the glyph's own
+*                          pixels for the other ops
+*                  rop -- LCD_ROP_COPY / _OR / _ANDNOT / _XOR
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_BlitGlyph(unsigned char row, signed short col, unsigned char offset,
+                          const unsigned char *mask, unsigned char rop)
+{
+  unsigned char i, p, pages;
+  unsigned char page = row >> 3;
+  unsigned char shift = row & 7;
+  unsigned char lo = 0, hi = 8;   // Visible glyph columns [lo, hi)
+  unsigned char shifted[8][3], shiftedMask[8][3];
+  const unsigned char (*src)[3];
+  const unsigned char (*m)[3] = lcdSolid;
+  
+  if (row >= LCD_HEIGHT || col <= -8 || col >= LCD_WIDTH) return;
+  if (col < 0) lo = (unsigned char)(-col);
+  if (col > LCD_WIDTH - 8) hi = (unsigned char)(LCD_WIDTH - col);
+  
+  src = LCD_GlyphColumns(offset, shift, shifted);
+  
+  if (mask) {
+    LCD_ShiftGlyph(mask, shift, shiftedMask);
+    m = (const unsigned char (*)[3])shiftedMask;
+  } else if (rop == LCD_ROP_COPY) {
+    static const unsigned char cell[16] = {
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+    };
+    LCD_ShiftGlyph(cell, shift, shiftedMask);
+    m = (const unsigned char (*)[3])shiftedMask;
+  }
+  
+  pages = shift ? 3 : 2;
+  if (pages > LCD_PAGES - page) pages = LCD_PAGES - page;
+  
+  for (p = 0; p < pages; p++) {
+    // Index of glyph column 0, which is off the buffer when col < 0 on page
+    // 0: only ever add a visible i to it, never form the pointer
+    int base = (int)(page + p) * LCD_WIDTH + col;
+    unsigned char first = 8, last = 0;
+    
+    for (i = lo; i < hi; i++) {
+      unsigned char *dst = &frameBuffer[base + i];
+      unsigned char bits = src[i][p] & m[i][p];
+      unsigned char data;
+      
+      switch (rop) {
+        case LCD_ROP_COPY:   data = (*dst & ~m[i][p]) | bits; break;
+        case LCD_ROP_ANDNOT: data = *dst & ~bits; break;
+        case LCD_ROP_XOR:    data = *dst ^ bits; break;
+        default:             data = *dst | bits; break;
+      }
+      if (data != *dst) {
+        *dst = data;
+        if (first == 8) first = i;
+        last = i;
+      }
+    }
+    if (first != 8) LCD_MarkDirtyCols(page + p, col + first, col + last);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawGlyph
+* Description    : OR a glyph in at any pixel row and column (its unset pixels
+*                  are transparent); see LCD_Buffer_BlitGlyph()
+* Input          : row -- top pixel row (0-63)
+*                  col -- column of the glyph's left edge (-7 to 127 visible)
+*                  offset -- index in ChineseTable
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_DrawGlyph(unsigned char row, signed short col, unsigned char offset)
+{
+  LCD_Buffer_BlitGlyph(row, col, offset, 0, LCD_ROP_OR);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawSprite
+* Description    : LCD_Buffer_DrawGlyph() for a sprite made of consecutive
+*                  ChineseTable glyphs side by side (16x16 = 2 glyphs)
+* Input          : row -- top pixel row (0-63)
+*                  col -- column of the first glyph, clipped like a glyph
+*                  offset -- index of the first glyph in ChineseTable
+*                  width -- number of glyphs
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_DrawSprite(unsigned char row, signed short col, unsigned char offset, unsigned char width)
+{
+  while (width--) {
+    LCD_Buffer_BlitGlyph(row, col, offset++, 0, LCD_ROP_OR);
+    col += 8;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_BlitSprite
+* Description    : LCD_Buffer_BlitGlyph() for consecutive glyphs side by side
+* Input          : row -- top pixel row (0-63)
+*                  col -- column of the first glyph, clipped like a glyph
+*                  offset -- index of the first glyph in ChineseTable
+*                  width -- number of glyphs
+*                  mask -- 16 bytes per glyph (width * 16), or NULL
+*                  rop -- LCD_ROP_*
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_BlitSprite(unsigned char row, signed short col, unsigned char offset, unsigned char width,
+                           const unsigned char *mask, unsigned char rop)
+{
+  while (width--) {
+    LCD_Buffer_BlitGlyph(row, col, offset++, mask, rop);
+    if (mask) mask += 16;
+    col += 8;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_MakeGlyphMask
+* Description    : Transparency mask for a glyph: in every column, opaque from
+*                  its top set pixel to its bottom one. Drawn with
+*                  LCD_ROP_COPY the sprite hides what is behind its outline
+*                  but keeps the background around it.
+* Input          : offset -- index in ChineseTable
+* Output         : mask -- 16 bytes in glyph layout
+* Return         : None
+*******************************************************************************/
+void LCD_MakeGlyphMask(unsigned char offset, unsigned char *mask)
+{
+  unsigned char i;
+  const unsigned char *c = ChineseTable[offset];
+  
+  for (i = 0; i < 8; i++) {
+    uint16_t bits = (uint16_t)(c[i] | (c[8 + i] << 8));
+    uint16_t hull = 0;
+    
+    if (bits) {
+      uint16_t top = bits & (uint16_t)-bits;       // Lowest set bit = top pixel
+      uint16_t bottom = 0x8000;
+      while (!(bits & bottom)) bottom >>= 1;       // Highest set bit = bottom pixel
+      hull = (uint16_t)((bottom - top) | bottom);  // Every bit from top to bottom
+    }
+    mask[i] = (unsigned char)hull;
+    mask[8 + i] = (unsigned char)(hull >> 8);
+  }
+}
+
+// ============================================================================
+// BACKGROUND LAYER
+// ============================================================================
+
+/*******************************************************************************
+* Function Name  : LCD_Background_Capture
+* Description    : Take the frame buffer as it is now (static scenery drawn,
+*                  no sprites yet) as the background erases restore from
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Background_Capture(void)
+{
+  unsigned int i;
+  
+  for (i = 0; i < LCD_BUFFER_SIZE; i++) {
+    backgroundBuffer[i] = frameBuffer[i];
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Background_Clear
+* Description    : Empty background: erases write zeros again
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Background_Clear(void)
+{
+  unsigned int i;
+  
+  for (i = 0; i < LCD_BUFFER_SIZE; i++) {
+    backgroundBuffer[i] = 0;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_RowMask
+* Description    : Bits of one page that lie in a row range
+* Input          : page -- page number (0-7)
+*                  y1, y2 -- row range (y1 <= y2)
+* Output         : None
+* Return         : Byte mask, 0 -- page outside the range
+*******************************************************************************/
+static unsigned char LCD_RowMask(unsigned char page, signed short y1, signed short y2)
+{
+  signed short top = (signed short)page * 8;
+  unsigned char mask = 0xFF;
+  
+  if (y2 < top || y1 > top + 7) return 0;
+  if (y1 > top) mask &= 0xFF << (y1 - top);
+  if (y2 < top + 7) mask &= 0xFF >> (top + 7 - y2);
+  return mask;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_RestoreRect
+* Description    : Erase a rectangle back to the background layer, clipped to
+*                  the screen. Page by page with one row mask, each page
+*                  marked dirty once over the columns that changed.
+* Input          : x1, y1 -- top-left corner (may be off screen)
+*                  x2, y2 -- bottom-right corner (inclusive)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_RestoreRect(signed short x1, signed short y1, signed short x2, signed short y2)
+{
+  unsigned char page, pageStart, pageEnd, mask, x;
+  
+  if (x1 < 0) x1 = 0;
+  if (y1 < 0) y1 = 0;
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH - 1;
+  if (y2 >= LCD_HEIGHT) y2 = LCD_HEIGHT - 1;
+  if (x1 > x2 || y1 > y2) return;
+  
+  pageStart = y1 >> 3;
+  pageEnd = y2 >> 3;
+  for (page = pageStart; page <= pageEnd; page++) {
+    unsigned int base = (unsigned int)page * LCD_WIDTH;
+    unsigned char first = LCD_WIDTH, last = 0;
+    
+    mask = 0xFF;
+    if (page == pageStart) mask &= 0xFF << (y1 & 7);
+    if (page == pageEnd)   mask &= 0xFF >> (7 - (y2 & 7));
+    
+    for (x = (unsigned char)x1; x <= (unsigned char)x2; x++) {
+      unsigned char data = (frameBuffer[base + x] & ~mask) | (backgroundBuffer[base + x] & mask);
+      if (data != frameBuffer[base + x]) {
+        frameBuffer[base + x] = data;
+        if (first == LCD_WIDTH) first = x;
+        last = x;
+      }
+    }
+    if (first != LCD_WIDTH) LCD_MarkDirtyCols(page, first, last);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_MoveSprite
+* Description    : Erase a sprite at its old position (back to the
+*                  background, like LCD_Buffer_RestoreRect()) and draw it at
+*                  the new one (OR-ed, like LCD_Buffer_DrawSprite()) in one
+*                  pass. Where the two footprints overlap, every byte of their
+*                  union is worked out in a register and written once, only
+*                  if it changed, and each page is marked dirty once; a sprite
+*                  that has not moved or changed writes nothing. Footprints
+*                  that do not overlap are simply erased and drawn.
+*                  Host/move_check compares it with erase-then-draw.
+* Input          : from -- old position, NULL -- nothing to erase
+*                  to -- new position (clipped at the edges like a glyph)
+*                  sprite -- glyphs drawn at the new position; the old
+*                            footprint is taken to be the same size
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Buffer_MoveSprite(const LCD_SpritePos *from, const LCD_SpritePos *to, const LCD_Sprite *sprite)
+{
+  unsigned char shifted[LCD_SPRITE_MAX_WIDTH][8][3];
+  const unsigned char (*glyph[LCD_SPRITE_MAX_WIDTH])[3];
+  unsigned char width = sprite->width > LCD_SPRITE_MAX_WIDTH ? LCD_SPRITE_MAX_WIDTH : sprite->width;
+  signed short span = (signed short)width * 8;
+  signed short toRight = to->col + span - 1;
+  signed short fromRight, x1, x2, y1, y2;
+  unsigned char toPage = to->row >> 3;
+  unsigned char page, g;
+  
+  if (from) fromRight = from->col + span - 1;
+  if (!from || from->col > toRight || to->col > fromRight ||
+      from->row > to->row + 15 || to->row > from->row + 15) {
+    if (from) LCD_Buffer_RestoreRect(from->col, from->row, fromRight, from->row + 15);
+    LCD_Buffer_DrawSprite(to->row, to->col, sprite->offset, width);
+    return;
+  }
+  
+  // Union of the two footprints, clipped to the screen
+  x1 = from->col < to->col ? from->col : to->col;
+  x2 = fromRight > toRight ? fromRight : toRight;
+  y1 = from->row < to->row ? from->row : to->row;
+  y2 = (from->row > to->row ? from->row : to->row) + 15;
+  if (x1 < 0) x1 = 0;
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH - 1;
+  if (y2 >= LCD_HEIGHT) y2 = LCD_HEIGHT - 1;
+  if (x1 > x2 || y1 > y2) return;
+  
+  for (g = 0; g < width; g++) {
+    glyph[g] = LCD_GlyphColumns(sprite->offset + g, to->row & 7, shifted[g]);
+  }
+  
+  for (page = (unsigned char)(y1 >> 3); page <= (unsigned char)(y2 >> 3); page++) {
+    unsigned int base = (unsigned int)page * LCD_WIDTH;
+    unsigned char eraseMask = LCD_RowMask(page, from->row, from->row + 15);
+    unsigned char drawPage = page - toPage;   // Page of the shifted glyph (0-2)
+    unsigned char drawing = LCD_RowMask(page, to->row, to->row + 15) != 0;
+    unsigned char first = LCD_WIDTH, last = 0;
+    signed short x;
+    
+    for (x = x1; x <= x2; x++) {
+      unsigned char data = frameBuffer[base + x];
+      
+      if (eraseMask && x >= from->col && x <= fromRight) {
+        data = (data & ~eraseMask) | (backgroundBuffer[base + x] & eraseMask);
+      }
+      if (drawing && x >= to->col && x <= toRight) {
+        unsigned char dx = (unsigned char)(x - to->col);
+        data |= glyph[dx >> 3][dx & 7][drawPage];
+      }
+      if (data != frameBuffer[base + x]) {
+        frameBuffer[base + x] = data;
+        if (first == LCD_WIDTH) first = (unsigned char)x;
+        last = (unsigned char)x;
+      }
+    }
+    if (first != LCD_WIDTH) LCD_MarkDirtyCols(page, first, last);
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_SetPixel
+* Description    : Set or clear a specific pixel at (x, y) in the frame buffer
+* Input          : x -- x coordinate (0-127, column position)
+                   y -- y coordinate (0-63, row position)
+                   state -- 1: set pixel (turn on), 0: clear pixel (turn off)
+* Output         : None
+* Return         : 0 -- failure (out of bounds)
+                   1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_SetPixel(unsigned char x, unsigned char y, unsigned char state)
+{
+  if (x >= LCD_WIDTH || y >= LCD_HEIGHT)
+    return 0;
+  
+  LCD_Buffer_ApplyMask(y / 8, x, 1 << (y % 8), state);
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawLine
+* Description    : Draw a horizontal line from (x1, y) to (x2, y) in the frame buffer
+* Input          : x1, x2 -- start and end x coordinates (0-127)
+                   y -- y coordinate (0-63)
+                   state -- 1: draw line, 0: erase line
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawLine(unsigned char x1, unsigned char x2, unsigned char y, unsigned char state)
+{
+  if (y >= LCD_HEIGHT)
+    return 0;
+  
+  if (x1 <= x2)
+    LCD_Buffer_Span(x1, x2, y, state);
+  else
+    LCD_Buffer_Span(x2, x1, y, state);
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawVLine
+* Description    : Draw a vertical line in the frame buffer (one byte per page)
+* Input          : x -- x coordinate
+                   y1, y2 -- start and end y coordinates
+                   state -- 1: draw, 0: erase
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawVLine(unsigned char x, unsigned char y1, unsigned char y2, unsigned char state)
+{
+  unsigned char start_y, end_y;
+  
+  if (x >= LCD_WIDTH)
+    return 0;
+  
+  // Ensure y1 <= y2
+  start_y = (y1 <= y2) ? y1 : y2;
+  end_y = (y1 <= y2) ? y2 : y1;
+  
+  if (start_y >= LCD_HEIGHT)
+    return 1;
+  if (end_y >= LCD_HEIGHT)
+    end_y = LCD_HEIGHT - 1;
+  
+  LCD_Buffer_Fill(x, x, start_y, end_y, state);
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawLineAngle
+* Description    : Draw a line at any angle (Bresenham) in the frame buffer
+* Input          : x0, y0 -- start point coordinates
+                   x1, y1 -- end point coordinates
+                   state -- 1: draw, 0: erase
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawLineAngle(unsigned char x0, unsigned char y0, unsigned char x1, unsigned char y1, unsigned char state)
+{
+  signed short dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  signed short dy = y1 > y0 ? y1 - y0 : y0 - y1;
+  signed short sx = x0 < x1 ? 1 : -1;
+  signed short sy = y0 < y1 ? 1 : -1;
+  signed short err = dx - dy;
+  signed short e2;
+  signed short cur_x = x0;
+  signed short cur_y = y0;
+  
+  while (1)
+  {
+    LCD_Buffer_Plot(cur_x, cur_y, state);
+    
+    if (cur_x == x1 && cur_y == y1)
+      break;
+    
+    e2 = 2 * err;
+    if (e2 > -dy)
+    {
+      err -= dy;
+      cur_x += sx;
+    }
+    if (e2 < dx)
+    {
+      err += dx;
+      cur_y += sy;
+    }
+  }
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawRect
+* Description    : Draw a rectangle outline in the frame buffer
+* Input          : x1, y1 -- top-left corner coordinates
+                   x2, y2 -- bottom-right corner coordinates
+                   state -- 1: draw, 0: erase
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawRect(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state)
+{
+  unsigned char temp;
+  
+  if (x1 >= LCD_WIDTH || x2 >= LCD_WIDTH || y1 >= LCD_HEIGHT || y2 >= LCD_HEIGHT)
+    return 0;
+  
+  if (x1 > x2) { temp = x1; x1 = x2; x2 = temp; }
+  if (y1 > y2) { temp = y1; y1 = y2; y2 = temp; }
+  
+  // Horizontal edges share one mask per byte, vertical edges one byte per page
+  LCD_Buffer_Span(x1, x2, y1, state);
+  LCD_Buffer_Span(x1, x2, y2, state);
+  LCD_Buffer_Fill(x1, x1, y1, y2, state);
+  LCD_Buffer_Fill(x2, x2, y1, y2, state);
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_FillRect
+* Description    : Draw a filled rectangle in the frame buffer
+* Input          : x1, y1 -- top-left corner coordinates
+                   x2, y2 -- bottom-right corner coordinates
+                   state -- 1: fill, 0: clear
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_FillRect(unsigned char x1, unsigned char y1, unsigned char x2, unsigned char y2, unsigned char state)
+{
+  unsigned char temp;
+  
+  // Ensure proper ordering
+  if (x1 > x2) { temp = x1; x1 = x2; x2 = temp; }
+  if (y1 > y2) { temp = y1; y1 = y2; y2 = temp; }
+  
+  // Boundary check
+  if (x1 >= LCD_WIDTH || y1 >= LCD_HEIGHT)
+    return 0;
+  
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH - 1;
+  if (y2 >= LCD_HEIGHT) y2 = LCD_HEIGHT - 1;
+  
+  LCD_Buffer_Fill(x1, x2, y1, y2, state);
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawCircle
+* Description    : Draw a circle outline (Bresenham) in the frame buffer
+* Input          : xc, yc -- center coordinates
+                   radius -- circle radius
+                   state -- 1: draw, 0: erase
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawCircle(unsigned char xc, unsigned char yc, unsigned char radius, unsigned char state)
+{
+  signed short x = 0;
+  signed short y = radius;
+  signed short d = 3 - 2 * radius;
+  
+  if (xc >= LCD_WIDTH || yc >= LCD_HEIGHT)
+    return 0;
+  
+  while (y >= x)
+  {
+    // 8 symmetric points, clipped individually
+    LCD_Buffer_Plot(xc + x, yc + y, state);
+    LCD_Buffer_Plot(xc - x, yc + y, state);
+    LCD_Buffer_Plot(xc + x, yc - y, state);
+    LCD_Buffer_Plot(xc - x, yc - y, state);
+    LCD_Buffer_Plot(xc + y, yc + x, state);
+    LCD_Buffer_Plot(xc - y, yc + x, state);
+    LCD_Buffer_Plot(xc + y, yc - x, state);
+    LCD_Buffer_Plot(xc - y, yc - x, state);
+    
+    x++;
+    
+    if (d > 0)
+    {
+      y--;
+      d = d + 4 * (x - y) + 10;
+    }
+    else
+    {
+      d = d + 4 * x + 6;
+    }
+  }
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_FillCircle
+* Description    : Draw a filled circle in the frame buffer
+* Input          : xc, yc -- center coordinates
+                   radius -- circle radius
+                   state -- 1: fill, 0: clear
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_FillCircle(unsigned char xc, unsigned char yc, unsigned char radius, unsigned char state)
+{
+  signed short x = 0;
+  signed short y = radius;
+  signed short d = 3 - 2 * radius;
+  
+  if (xc >= LCD_WIDTH || yc >= LCD_HEIGHT)
+    return 0;
+  
+  while (y >= x)
+  {
+    // Horizontal spans fill the circle
+    LCD_Buffer_Span(xc - x, xc + x, yc + y, state);
+    LCD_Buffer_Span(xc - x, xc + x, yc - y, state);
+    LCD_Buffer_Span(xc - y, xc + y, yc + x, state);
+    LCD_Buffer_Span(xc - y, xc + y, yc - x, state);
+    
+    x++;
+    
+    if (d > 0)
+    {
+      y--;
+      d = d + 4 * (x - y) + 10;
+    }
+    else
+    {
+      d = d + 4 * x + 6;
+    }
+  }
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_DrawTriangle
+* Description    : Draw a triangle outline in the frame buffer
+* Input          : x0, y0, x1, y1, x2, y2 -- three vertex coordinates
+                   state -- 1: draw, 0: erase
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+*******************************************************************************/
+unsigned char LCD_Buffer_DrawTriangle(unsigned char x0, unsigned char y0, 
+                                       unsigned char x1, unsigned char y1,
+                                       unsigned char x2, unsigned char y2, 
+                                       unsigned char state)
+{
+  LCD_Buffer_DrawLineAngle(x0, y0, x1, y1, state);
+  LCD_Buffer_DrawLineAngle(x1, y1, x2, y2, state);
+  LCD_Buffer_DrawLineAngle(x2, y2, x0, y0, state);
+  
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Buffer_FillTriangle
+* Description    : Draw a filled triangle in the frame buffer
+* Input          : x0, y0, x1, y1, x2, y2 -- three vertex coordinates
+                   state -- 1: fill, 0: clear
+* Output         : None
+* Return         : 0 -- failure, 1 -- success
+* Note           : Uses scanline algorithm
+*******************************************************************************/
+unsigned char LCD_Buffer_FillTriangle(unsigned char x0, unsigned char y0, 
+                                       unsigned char x1, unsigned char y1,
+                                       unsigned char x2, unsigned char y2, 
+                                       unsigned char state)
+{
+  signed short a, b, y, last, temp;
+  signed short dx01, dy01, dx02, dy02, dx12, dy12;
+  signed long sa = 0, sb = 0;
+  unsigned char t;
+  
+  // Sort coordinates by Y order (y0 <= y1 <= y2)
+  if (y0 > y1) {
+    t = y0; y0 = y1; y1 = t;
+    t = x0; x0 = x1; x1 = t;
+  }
+  if (y1 > y2) {
+    t = y2; y2 = y1; y1 = t;
+    t = x2; x2 = x1; x1 = t;
+  }
+  if (y0 > y1) {
+    t = y0; y0 = y1; y1 = t;
+    t = x0; x0 = x1; x1 = t;
+  }
+  
+  if (y0 == y2) // All on same line
+  {
+    a = b = x0;
+    if (x1 < a)      a = x1;
+    else if (x1 > b) b = x1;
+    if (x2 < a)      a = x2;
+    else if (x2 > b) b = x2;
+    LCD_Buffer_Span(a, b, y0, state);
+    return 1;
+  }
+  
+  dx01 = x1 - x0;
+  dy01 = y1 - y0;
+  dx02 = x2 - x0;
+  dy02 = y2 - y0;
+  dx12 = x2 - x1;
+  dy12 = y2 - y1;
+  
+  // For upper part of triangle, find scanline crossings
+  if (y1 == y2) last = y1;
+  else          last = y1 - 1;
+  
+  for (y = y0; y <= last; y++)
+  {
+    a = x0 + sa / dy01;
+    b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+    
+    if (a > b) { temp = a; a = b; b = temp; }
+    LCD_Buffer_Span(a, b, y, state);
+  }
+  
+  // For lower part of triangle
+  sa = (signed long)dx12 * (y - y1);
+  sb = (signed long)dx02 * (y - y0);
+  for (; y <= y2; y++)
+  {
+    a = x1 + sa / dy12;
+    b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+    
+    if (a > b) { temp = a; a = b; b = temp; }
+    LCD_Buffer_Span(a, b, y, state);
+  }
+  
+  return 1;
 }
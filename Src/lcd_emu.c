@@ -0,0 +1,320 @@
+/**
+ ******************************************************************************
+ * @file    lcd_emu.c
+ * @brief   Host (Linux) model of the ST7565-class LCD controller
+ ******************************************************************************
+ *
+ * Build together with lcd.c and lcd_host.c using -DHOST_BUILD. See lcd_emu.h.
+ *
+ ******************************************************************************
+ */
+
+#ifdef HOST_BUILD
+
+#include "lcd.h"
+
+typedef struct {
+  unsigned char ram[LCD_EMU_PAGES][LCD_EMU_COLS];
+  unsigned char page;
+  unsigned char col;
+  unsigned char startLine;
+  unsigned char adcReverse;       // Segment order mirrored
+  unsigned char comReverse;       // Common scan reversed
+  unsigned char displayOn;
+  unsigned char displayReverse;   // Inverted pixels
+  unsigned char allOn;            // All pixels on, RAM kept
+  unsigned char rmw;              // Read-modify-write mode
+  unsigned char rmwCol;           // Column to return to on RMW end
+  unsigned char latch;            // Read latch - the next data read returns this
+  unsigned char pendingArg;       // Two-byte command waiting for its argument
+  unsigned char volume;
+  unsigned char powerControl;
+} LCD_EmuState;
+
+static LCD_EmuState emu;
+static LCD_EmuStats emuFrame;     // Frame being counted
+static LCD_EmuStats emuLast;      // Last closed frame
+static LCD_EmuStats emuTotal;
+static unsigned long emuFrames = 0;
+static unsigned long emuAccessNs = 0;
+static unsigned char emuTimingOk = 0;   // Access meets t_CYC and t_PW
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_Count
+* Description    : Add one bus access to the frame counters
+*******************************************************************************/
+static void LCD_Emu_Count(unsigned long *counter)
+{
+  if (emuAccessNs == 0) {
+    // Reset BTR until LCD_BusTimingInit() programs the bank
+    LCD_Emu_SetTiming(LCD_FSMC_ADDSET_MAX, LCD_FSMC_DATAST_MAX, SystemCoreClock);
+  }
+  (*counter)++;
+  emuFrame.busNs += emuAccessNs;
+  if (!emuTimingOk) emuFrame.timingFaults++;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_SoftReset
+* Description    : State the LCD_Reset command restores. RAM, display on/off,
+*                  ADC and reverse/all-on modes are kept.
+*******************************************************************************/
+static void LCD_Emu_SoftReset(void)
+{
+  emu.page = 0;
+  emu.col = 0;
+  emu.startLine = 0;
+  emu.comReverse = 0;
+  emu.rmw = 0;
+  emu.pendingArg = 0;
+  emu.volume = 0x20;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_Reset
+* Description    : Power-on (RST pin) state. RAM is cleared so runs are
+*                  repeatable; counters are zeroed.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Emu_Reset(void)
+{
+  unsigned int p, c;
+
+  for (p = 0; p < LCD_EMU_PAGES; p++) {
+    for (c = 0; c < LCD_EMU_COLS; c++) {
+      emu.ram[p][c] = 0;
+    }
+  }
+  LCD_Emu_SoftReset();
+  emu.adcReverse = 0;
+  emu.displayOn = 0;
+  emu.displayReverse = 0;
+  emu.allOn = 0;
+  emu.latch = 0;
+  emu.powerControl = 0;
+
+  emuFrame = (LCD_EmuStats){0};
+  emuLast = (LCD_EmuStats){0};
+  emuTotal = (LCD_EmuStats){0};
+  emuFrames = 0;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_SetTiming
+* Description    : Cost of one bus access from the FSMC timing. An access takes
+*                  ADDSET + DATAST + 1 HCLK with WR/RD low for DATAST; when
+*                  that is under t_CYC or t_PW every access counts as a
+*                  timing fault. LCD_BusWait() is not modelled - it cannot
+*                  pad the DMA, so the FSMC timing has to be right by itself.
+* Input          : addset, datast -- FSMC_NORSRAM_TimingTypeDef values
+*                  hclkHz -- HCLK frequency
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Emu_SetTiming(unsigned int addset, unsigned int datast, unsigned long hclkHz)
+{
+  unsigned long long ns, pulseNs;
+
+  if (hclkHz == 0) hclkHz = 1;
+  ns = ((unsigned long long)(addset + datast + 1) * 1000000000ULL) / hclkHz;
+  pulseNs = ((unsigned long long)datast * 1000000000ULL) / hclkHz;
+  emuAccessNs = ns ? (unsigned long)ns : 1;
+  emuTimingOk = (ns >= LCD_T_CYC_NS && pulseNs >= LCD_T_PW_NS);
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_WriteCmd
+* Description    : Decode one command byte (A0=0 write)
+* Input          : cmd -- command byte
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Emu_WriteCmd(unsigned char cmd)
+{
+  LCD_Emu_Count(&emuFrame.cmdBytes);
+
+  // Second byte of a two-byte command
+  if (emu.pendingArg) {
+    if (emu.pendingArg == Set_Ref_Vol_Mode) emu.volume = cmd & 0x3F;
+    emu.pendingArg = 0;
+    return;
+  }
+
+  if ((cmd & 0xC0) == Set_Start_Line_X) {
+    emu.startLine = cmd & 0x3F;
+  } else if ((cmd & 0xF0) == Set_Page_Addr_X) {
+    emu.page = cmd & 0x0F;
+    if (emu.page >= LCD_EMU_PAGES) emu.page = LCD_EMU_PAGES - 1;
+  } else if ((cmd & 0xF0) == Set_ColH_Addr_X) {
+    emu.col = (unsigned char)(((cmd & 0x0F) << 4) | (emu.col & 0x0F));
+  } else if ((cmd & 0xF0) == Set_ColL_Addr_X) {
+    emu.col = (unsigned char)((emu.col & 0xF0) | (cmd & 0x0F));
+  } else if ((cmd & 0xF8) == Set_Resistor_Ratio_X) {
+    // Regulator resistor ratio - no visible effect
+  } else if ((cmd & 0xF8) == 0x28) {
+    emu.powerControl = cmd & 0x07;
+  } else if ((cmd & 0xF0) == COM_Scan_Dir_Normal) {
+    emu.comReverse = (cmd & 0x08) ? 1 : 0;
+  } else {
+    switch (cmd) {
+      case Display_Off:        emu.displayOn = 0; break;
+      case Display_On:         emu.displayOn = 1; break;
+      case Set_ADC_Normal:     emu.adcReverse = 0; break;
+      case Set_ADC_Reverse:    emu.adcReverse = 1; break;
+      case Display_Normal:     emu.displayReverse = 0; break;
+      case Display_Reverse:    emu.displayReverse = 1; break;
+      case Display_All_Normal: emu.allOn = 0; break;
+      case Display_All_On:     emu.allOn = 1; break;
+      case Set_LCD_Bias_7:
+      case Set_LCD_Bias_9:     break;
+      case RMW_Mode_En:        emu.rmw = 1; emu.rmwCol = emu.col; break;
+      case RMW_Mode_Dis:       if (emu.rmw) emu.col = emu.rmwCol; emu.rmw = 0; break;
+      case LCD_Reset:          LCD_Emu_SoftReset(); break;
+      case Set_Ref_Vol_Mode:   // Electronic volume, value follows
+      case 0xAC:               // Static indicator off, mode follows
+      case 0xAD:               // Static indicator on, mode follows
+      case 0xF8:               // Booster ratio, value follows
+        emu.pendingArg = cmd;
+        break;
+      default:                 break;   // NOP (0xE3) and test commands
+    }
+  }
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_WriteData
+* Description    : Write one byte to display RAM at page/col (A0=1 write); the
+*                  column auto-increments and stops at the last address
+* Input          : data -- byte to store
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Emu_WriteData(unsigned char data)
+{
+  LCD_Emu_Count(&emuFrame.dataBytes);
+
+  if (emu.col < LCD_EMU_COLS) emu.ram[emu.page][emu.col] = data;
+  if (emu.col < LCD_EMU_COLS - 1) emu.col++;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_ReadData
+* Description    : Data read (A0=1 read). Returns the read latch and reloads it
+*                  from RAM, so the first read after an address set or a write
+*                  is a dummy. The column advances except in RMW mode.
+* Input          : None
+* Output         : None
+* Return         : Latched byte
+*******************************************************************************/
+unsigned char LCD_Emu_ReadData(void)
+{
+  unsigned char data = emu.latch;
+
+  LCD_Emu_Count(&emuFrame.readBytes);
+
+  emu.latch = (emu.col < LCD_EMU_COLS) ? emu.ram[emu.page][emu.col] : 0;
+  if (!emu.rmw && emu.col < LCD_EMU_COLS - 1) emu.col++;
+  return data;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_ReadStatus
+* Description    : Status read (A0=0 read). The model never reports BUSY and
+*                  leaves reset immediately.
+* Input          : None
+* Output         : None
+* Return         : Status byte (ADC, ON/OFF, RESET, BUSY bits)
+*******************************************************************************/
+unsigned char LCD_Emu_ReadStatus(void)
+{
+  unsigned char status = 0;
+
+  LCD_Emu_Count(&emuFrame.readBytes);
+
+  if (emu.adcReverse) status |= 0x40;
+  if (!emu.displayOn) status |= LCD_STATUS_OFF;
+  return status;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_EndFrame
+* Description    : Close the counters of the current frame. Call after the
+*                  frame's flush has finished (LCD_WaitFlush()).
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void LCD_Emu_EndFrame(void)
+{
+  emuLast = emuFrame;
+  emuTotal.cmdBytes += emuFrame.cmdBytes;
+  emuTotal.dataBytes += emuFrame.dataBytes;
+  emuTotal.readBytes += emuFrame.readBytes;
+  emuTotal.busNs += emuFrame.busNs;
+  emuTotal.timingFaults += emuFrame.timingFaults;
+  emuFrame = (LCD_EmuStats){0};
+  emuFrames++;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_GetRam
+* Description    : Raw display RAM byte
+* Input          : page -- 0-8, col -- 0-131
+* Output         : None
+* Return         : RAM contents, 0 when out of range
+*******************************************************************************/
+unsigned char LCD_Emu_GetRam(unsigned char page, unsigned char col)
+{
+  if (page >= LCD_EMU_PAGES || col >= LCD_EMU_COLS) return 0;
+  return emu.ram[page][col];
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_GetPixel
+* Description    : Pixel as it appears on this board's panel. The panel is
+*                  mounted so that COM_Scan_Dir_Reverse shows page 0 at the top
+*                  (as set up by STM3210E_LCD_Init); the other COM direction
+*                  flips it. Start line, ADC, reverse, all-on and display off
+*                  are applied.
+* Input          : x -- 0-127, y -- 0-63
+* Output         : None
+* Return         : 1 -- pixel dark, 0 -- pixel clear
+*******************************************************************************/
+unsigned char LCD_Emu_GetPixel(unsigned char x, unsigned char y)
+{
+  unsigned char line, col, on;
+
+  if (x >= LCD_WIDTH || y >= 64) return 0;
+  if (!emu.displayOn) return 0;
+  if (emu.allOn) return 1;
+
+  line = emu.comReverse ? y : (unsigned char)(63 - y);
+  line = (unsigned char)((line + emu.startLine) & 0x3F);
+  col = emu.adcReverse ? (unsigned char)(LCD_EMU_COLS - 1 - x) : x;
+
+  on = (emu.ram[line / 8][col] >> (line % 8)) & 1;
+  return emu.displayReverse ? !on : on;
+}
+
+/*******************************************************************************
+* Function Name  : LCD_Emu_GetFrameStats / LCD_Emu_GetTotalStats
+* Description    : Counters of the last closed frame / since LCD_Emu_Reset()
+*******************************************************************************/
+void LCD_Emu_GetFrameStats(LCD_EmuStats *stats)
+{
+  *stats = emuLast;
+}
+
+void LCD_Emu_GetTotalStats(LCD_EmuStats *stats)
+{
+  *stats = emuTotal;
+}
+
+unsigned long LCD_Emu_GetFrameCount(void)
+{
+  return emuFrames;
+}
+
+#endif /* HOST_BUILD */
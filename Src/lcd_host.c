@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ * @file    lcd_host.c
+ * @brief   Host (Linux) stand-ins for the HAL pieces used by the LCD driver
+ ******************************************************************************
+ *
+ * Build together with lcd.c using -DHOST_BUILD. See lcd_host.h.
+ *
+ ******************************************************************************
+ */
+
+#ifdef HOST_BUILD
+
+#include "lcd.h"
+
+uint32_t SystemCoreClock = 8000000;
+
+LCD_HostDMATransfer LCD_Host_DMA_Log[LCD_HOST_DMA_LOG_SIZE];
+unsigned int LCD_Host_DMA_LogCount = 0;
+
+static DMA_HandleTypeDef *pendingHandle = NULL;
+static LCD_HostDMATransfer pending;
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+  (void)hdma;
+  pendingHandle = NULL;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uintptr_t SrcAddress, uintptr_t DstAddress, uint32_t DataLength)
+{
+  // Only one transfer per channel, same as the real controller
+  if (pendingHandle != NULL || DataLength == 0) return HAL_BUSY;
+
+  // Addresses are uintptr_t here so host pointers survive on 64-bit builds
+  pending.src = (const unsigned char *)(uintptr_t)SrcAddress;
+  pending.length = (unsigned short)DataLength;
+  pending.dst = DstAddress;
+  pendingHandle = hdma;
+  return HAL_OK;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  (void)Delay;
+}
+
+unsigned char LCD_Host_DMA_Busy(void)
+{
+  return pendingHandle != NULL;
+}
+
+void LCD_Host_DMA_Complete(void)
+{
+  DMA_HandleTypeDef *hdma = pendingHandle;
+  unsigned short i;
+
+  if (hdma == NULL) return;
+
+  // Memory-to-memory with a fixed destination: each byte is a data write
+  for (i = 0; i < pending.length; i++) {
+    LCD_BUS_WRITE_DATA(pending.src[i]);
+  }
+  if (LCD_Host_DMA_LogCount < LCD_HOST_DMA_LOG_SIZE) {
+    LCD_Host_DMA_Log[LCD_Host_DMA_LogCount++] = pending;
+  }
+
+  // Free the channel before the callback so it can chain the next run
+  pendingHandle = NULL;
+  if (hdma->XferCpltCallback != NULL) {
+    hdma->XferCpltCallback(hdma);
+  }
+}
+
+void LCD_Host_DMA_ResetLog(void)
+{
+  LCD_Host_DMA_LogCount = 0;
+}
+
+#endif /* HOST_BUILD */
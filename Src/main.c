@@ -27,10 +27,10 @@
   * - Game over and restart
   * 
   * TO CUSTOMIZE:
-  * - Change BUTTON_PIN and BUTTON_PORT in USER CODE BEGIN 0 section
-  * - Adjust MAX_OBSTACLES for more/fewer obstacles
-  * - Modify obstacle spawn rate in frameCount check
-  * - Change game speed with OBSTACLE_SPEED in function.h
+  * - Change BUTTON_PIN, BUTTON_PORT and BUTTON_EXTI_IRQn in input.h
+  * - Adjust MAX_OBSTACLES in function.h for more/fewer obstacles
+  * - Modify obstacle spawn rate with OBSTACLE_SPAWN_MIN/MAX in function.h
+  * - Change game speed with WORLD_SPEED_* in function.h
   * 
   ******************************************************************************
   * @attention
@@ -66,6 +66,15 @@
 #include "main.h"
 #include "function.h"
 #include "lcd.h"
+#include "profiler.h"
+#include "idle.h"
+#include "clock.h"
+#include "input.h"
+#include "pot.h"
+#include "prng.h"
+#include "game_core.h"
+#include "replay.h"
+#include "sim.h"
 
 /** @addtogroup STM32F1xx_HAL_Examples
   * @{
@@ -101,33 +110,169 @@ void Error_Handler(void);
 
 /* USER CODE BEGIN 0 */
 
-// Game variables
-#define MAX_OBSTACLES 3  // Allow multiple obstacles on screen simultaneously
-#define BUTTON_PIN GPIO_PIN_0  // Change to your actual button pin
-#define BUTTON_PORT GPIOA      // Change to your actual button port
+// Game variables - the whole game is a GameCore (game_core.h); main.c feeds
+// it input bits, renders through deviceIO and runs the screens around it
+// Jump button pin: BUTTON_PIN/BUTTON_PORT in input.h
 
-// Timer-based frame control
+// Fixed-rate simulation tick (sim.h): TIM1 sets the flag every SIM_TICK_PERIOD
 extern volatile unsigned char gameTimerFlag;
 
-Obstacle obstacles[MAX_OBSTACLES];
-unsigned char obstacleSpawnCounter = 0;
-unsigned int nextObstacleSpawn = 100;  // Frame count for next spawn
-
-// Simple pseudo-random number generator
-unsigned int randomSeed = 12345;
-unsigned int getRandomSpawnInterval(void) {
-  // Linear congruential generator for pseudo-random numbers
-  randomSeed = (randomSeed * 1103515245 + 12345) & 0x7FFFFFFF;
-  // Map to range [OBSTACLE_SPAWN_MIN, OBSTACLE_SPAWN_MAX]
-  return OBSTACLE_SPAWN_MIN + (randomSeed % (OBSTACLE_SPAWN_MAX - OBSTACLE_SPAWN_MIN + 1));
+GameCore core;
+unsigned char buttonLevel = 0;  // Button level after the last event taken
+
+// GameCore side effects on this board: frame buffer, LEDs, profiler
+const GameIO deviceIO = {
+  clearSprite,
+  moveDino,
+  moveCactus,
+  updateLivesLED,
+  Prof_Mark
+};
+
+// Button events since the last frame as GAME_INPUT_* bits - a press shorter
+// than a frame still sets GAME_INPUT_PRESS (for the frame's first tick)
+unsigned char readInputBits(void) {
+  unsigned char bits = 0;
+  InputEvent inputEvent;
+  while (Input_Poll(&inputEvent)) {
+    buttonLevel = inputEvent.pressed;
+    if (inputEvent.pressed) bits |= GAME_INPUT_PRESS;
+  }
+  if (buttonLevel) bits |= GAME_INPUT_BUTTON;
+  return bits;
+}
+
+// Session recording (replay.h): every game is recorded. TAMPER on the start
+// screen arms playback - of a recording sent over USART1 within
+// REPLAY_RX_TIMEOUT_MS, else of the last game - for the next start press.
+#define REPLAY_RX_TIMEOUT_MS 2000
+Replay replay;
+ReplayCursor replayCursor;
+unsigned char replayArmed = 0;
+unsigned char replaying = 0;
+
+// New game with the selected lives; the seed comes from the entropy pool
+// (the fixed seed in deterministic mode). An armed replay brings its own
+// seed and lives instead.
+void startGame(unsigned char lives) {
+  if (replayArmed && replay.ticks > 0) {
+    GameCore_Init(&core, replay.seed, replay.lives);
+    Replay_Rewind(&replayCursor, &replay);
+    replaying = 1;
+  } else {
+    uint32_t seed = Prng_GameSeed();
+    GameCore_Init(&core, seed, lives);
+    Replay_Begin(&replay, seed, lives);
+    replaying = 0;
+  }
+  replayArmed = 0;
+  buttonLevel = 0;  // The start press was taken; its release arrives as an event
+  Sim_Reset();      // Menu time is not simulated
+}
+
+// Stats dump - press TAMPER (PC13, active low) to send the main loop profile
+// and the per-frame LCD bus histograms over USART1
+#define DUMP_PIN GPIO_PIN_13
+#define DUMP_PORT GPIOC
+unsigned char dumpButtonWasPressed = 0;
+
+void uartWriteText(const char *text, unsigned int length) {
+  HAL_UART_Transmit(&huart1, (uint8_t *)text, length, 0xffff);
+}
+
+void checkStatsDump(void) {
+  unsigned char pressed = (HAL_GPIO_ReadPin(DUMP_PORT, DUMP_PIN) == GPIO_PIN_RESET);
+  // Edge triggered - one dump per press (blocks for the transmit)
+  if (pressed && !dumpButtonWasPressed) {
+    Prof_Dump(uartWriteText);
+    Idle_Dump(uartWriteText);
+    Input_Dump(uartWriteText);
+    Clock_Dump(uartWriteText);
+    Sim_Dump(uartWriteText);
+    LCD_DumpTrafficStats(uartWriteText);
+    Replay_Dump(&replay, uartWriteText);  // The game so far, or the last one
+  }
+  dumpButtonWasPressed = pressed;
+}
+
+// Re-derive everything clocked from a bus after Clock_Switch()
+void onClockChange(void) {
+  // TIM1: new prescaler, loaded by an update event that does not raise the
+  // interrupt (URS); the frame period restarts
+  __HAL_TIM_SET_PRESCALER(&htim1, Clock_Tim1Prescaler());
+  htim1.Instance->CR1 |= TIM_CR1_URS;
+  htim1.Instance->EGR = TIM_EGR_UG;
+  htim1.Instance->CR1 &= ~TIM_CR1_URS;
+  // USART1 is on APB2
+  huart1.Instance->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK2Freq(), huart1.Init.BaudRate);
+  // FSMC bank 4 timing for the new HCLK, written to the BTR. The flush was
+  // drained before the switch (and LCD_BusTimingInit() waits for it again),
+  // so no access runs on the old timing at the new clock.
+  LCD_BusTimingInit();
+}
+
+// Clock changes only between frames, with the DMA flush drained
+void setClockProfile(unsigned char profile) {
+  LCD_WaitFlush();
+  Clock_Switch(profile);
+}
+
+// Arm replay playback for the next game. Waits up to REPLAY_RX_TIMEOUT_MS
+// for Replay_Dump text on USART1; without any, the recording in RAM stays.
+void armReplay(void) {
+  ReplayParser parser;
+  uint8_t ch;     // One byte per character: USART1 is 8N1 (MX_USART1_UART_Init)
+  unsigned char result = REPLAY_PARSE_MORE;
+
+  uartWriteText("replay?\r\n", 9);
+  Replay_ParserInit(&parser, &replay);
+  while (result == REPLAY_PARSE_MORE &&
+         HAL_UART_Receive(&huart1, &ch, 1, REPLAY_RX_TIMEOUT_MS) == HAL_OK) {
+    result = Replay_ParseChar(&parser, (char)ch);
+  }
+  result = Replay_ParseEnd(&parser);
+  if (result == REPLAY_PARSE_ERROR) {
+    uartWriteText("replay error\r\n", 14);
+  } else if (replay.ticks > 0) {
+    uartWriteText("replay armed\r\n", 14);
+    replayArmed = 1;
+  }
+}
+
+// A playback stopped: all recorded frames played, or the game ended early.
+// Report whether it ended where the recording did; input is live again.
+void endReplay(void) {
+  if (Replay_Check(&replay, core.tickCount, core.state.score)) {
+    uartWriteText("replay ok\r\n", 11);
+  } else {
+    uartWriteText("replay MISMATCH\r\n", 17);
+  }
+  replaying = 0;
 }
 
-unsigned char getRandomObstacleType(void) {
-  // Update random seed with additional entropy from system tick
-  randomSeed = (randomSeed * 1103515245 + 12345 + HAL_GetTick()) & 0x7FFFFFFF;
-  // 50% chance for big cactus (type 0), 50% for small cactus (type 1)
-  // Use higher bits which have better randomness in LCG
-  return ((randomSeed >> 16) % 2);
+// Start screen: the variable resistor selects lives until the button is
+// pressed. The pot is sampled by DMA; the CPU only wakes when its watchdog
+// sees it move (or on SysTick, for TAMPER).
+// 0-1023 = 1 life, 1024-2047 = 2 lives, 2048-3071 = 3 lives, 3072-4095 = 4 lives
+unsigned char selectLives(void) {
+  Pot_Poll();
+  unsigned char selectedLives = Pot_GetLives();
+  updateLivesLED(selectedLives);
+  
+  while (!Input_TakePress()) {
+    if (Pot_Poll()) {
+      selectedLives = Pot_GetLives();
+      updateLivesLED(selectedLives);  // Update LEDs to show selected lives
+    }
+    unsigned char dumpPressed = (HAL_GPIO_ReadPin(DUMP_PORT, DUMP_PIN) == GPIO_PIN_RESET);
+    if (dumpPressed && !dumpButtonWasPressed) {
+      armReplay();
+    }
+    dumpButtonWasPressed = dumpPressed;
+    Idle_WaitEvent();
+    Prng_EntropyAdd(Prof_Now() ^ Pot_GetLatestSample());  // Wake-up jitter and ADC noise
+  }
+  return selectedLives;
 }
 
 /* USER CODE END 0 */
@@ -145,6 +290,14 @@ int main(void)
   LCD_Init();
   LCD_Clear();
   LCD_InitFrameBuffer();  // Initialize frame buffer system
+  cacheSprites();         // Dino/cactus glyphs pre-shifted, dead dino mask
+  LCD_InitDMA();          // Frames go out by DMA while the next one is computed
+  LCD_SetFlushMode(LCD_FLUSH_MODE_DMA);
+  Prof_Init();            // Cycle counter for the main loop phase profile
+  Idle_Init();            // Sleep/active accounting, on the same cycle counter
+  Clock_SetChangeCallback(onClockChange);
+  Input_Init();           // Button edges -> debounced, timestamped event queue
+  Pot_Init(&hadc1);       // Lives pot: continuous ADC into a circular DMA buffer
 	
 	/* Check TIM Init----------------------------------------------------------*/
 	if (HAL_TIM_Base_Start_IT(&htim1) != HAL_OK)
@@ -159,60 +312,19 @@ int main(void)
 
 	/* -------------------------------MAIN PROGRAM-----------------------------*/
   
-  // Initialize game state
-  DinoGameState game;
-  initGameState(&game);
-  
-  // Initialize obstacles
-  for (int i = 0; i < MAX_OBSTACLES; i++) {
-    obstacles[i].active = 0;
-  }
-  
   // ===== START SCREEN: Select lives using ADC =====
   drawStartScreen();
   LCD_SwapBuffers();  // Flush start screen to LCD
-  unsigned char selectedLives = 1;
-  updateLivesLED(selectedLives);
+  setClockProfile(CLOCK_PROFILE_MENU);  // Little to do until the button
+  unsigned char selectedLives = selectLives();
   
-  // Wait for button press while reading ADC to select lives
-  while (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN) != GPIO_PIN_SET) {
-    // Read ADC value from variable resistor
-    HAL_ADC_Start(&hadc1);
-    HAL_ADC_PollForConversion(&hadc1, 100);
-    uint32_t adcValue = HAL_ADC_GetValue(&hadc1);
-    HAL_ADC_Stop(&hadc1);
-    
-    // Map ADC value (0-4095) to lives (1-4)
-    // 0-1023 = 1 life, 1024-2047 = 2 lives, 2048-3071 = 3 lives, 3072-4095 = 4 lives
-    if (adcValue < 1024) {
-      selectedLives = 1;
-    } else if (adcValue < 2048) {
-      selectedLives = 2;
-    } else if (adcValue < 3072) {
-      selectedLives = 3;
-    } else {
-      selectedLives = 4;
-    }
-    
-    // Update LEDs to show selected lives
-    updateLivesLED(selectedLives);
-    
-    HAL_Delay(50);  // Small delay to avoid flickering
-  }
-  
-  // Button pressed - start the game
-  HAL_Delay(200);  // Debounce
-  game.lives = selectedLives;
-  
-  // Seed random generator with ADC value for varied gameplay
-  HAL_ADC_Start(&hadc1);
-  HAL_ADC_PollForConversion(&hadc1, 100);
-  randomSeed = HAL_ADC_GetValue(&hadc1) + HAL_GetTick();
-  HAL_ADC_Stop(&hadc1);
-  nextObstacleSpawn = 10;  // First obstacle spawns quickly after game start
+  // Button pressed - start the game; the press time ends the entropy gathering
+  setClockProfile(CLOCK_PROFILE_DEFAULT);
+  Prng_EntropyAdd(Prof_Now());
+  startGame(selectedLives);
   
   // printf("\r\n=== GAME START ===\r\n");
-  // printf("Lives: %d\r\n", game.lives);
+  // printf("Lives: %d\r\n", core.state.lives);
   
   // Clear start screen and draw game elements
   clearStartScreen();
@@ -220,203 +332,101 @@ int main(void)
   drawGroundLine(0);
   drawStar(0, 20);   // Static star decoration at top
   drawMoon(0, 90);   // Moon decoration at top
+  LCD_Background_Capture();  // Sprites erase back to this scenery
   LCD_FlushBuffer(); // Initial full flush for static elements
   
-  unsigned int frameCount = 0;
-  unsigned int obstacleFrameCounter = 0;
   unsigned char gameOver = 0;
+  Idle_AbortFrame();      // Start counting from the first game frame
 
   /* Infinite loop */
   while (1)
   {
     if (!gameOver) {
-      // Clear old dino position
-      clearSprite(game.dinoX, game.dinoY, 2);
-      
-      // Check for button press (jump) - level triggered (every frame for responsiveness)
-      GPIO_PinState buttonState = HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN);
-      if (buttonState == GPIO_PIN_SET) {
-        game.buttonHeld = 1;  // Track button is being held
-        if (!game.isJumping && game.jumpHeight == 0) {
-          game.isJumping = 1;
-        }
-      } else {
-        game.buttonHeld = 0;  // Button released
-      }
-      
-      // Update physics at controlled rate (not every frame)
-      game.physicsTimer++;
-      if (game.physicsTimer >= JUMP_PHYSICS_SPEED) {
-        game.physicsTimer = 0;
-        handleJump(&game);
-      }
+      Prof_BeginFrame();
       
-      // Update animation at controlled rate
-      game.animTimer++;
-      if (game.animTimer >= DINO_ANIM_SPEED) {
-        game.animTimer = 0;
-        updateDinoAnimation(&game);
-      }
-      
-      // Draw dino at new position
-      drawDino(&game);
-      
-      // Spawn obstacles with random spacing
-      frameCount++;
-      if (frameCount >= nextObstacleSpawn) {
-        for (int i = 0; i < MAX_OBSTACLES; i++) {
-          if (!obstacles[i].active) {
-            obstacles[i].x = GROUND_PAGE - 2;  // 2 page above ground
-            obstacles[i].y = 120;  // Start from right side
-            obstacles[i].type = getRandomObstacleType();  // Random: 0=big, 1=small cactus
-            obstacles[i].active = 1;
-            // Set next spawn time with random interval
-            nextObstacleSpawn = frameCount + getRandomSpawnInterval();
-            break;
-          }
+      // One GameCore_Step per simulation tick that came due since the last
+      // frame (it marks the profiler phases itself)
+      unsigned char inputBits = readInputBits();
+      uint32_t ticks = Sim_TakeTicks();
+      for (uint32_t t = 0; t < ticks && !gameOver; t++) {
+        unsigned char tickBits = inputBits;
+        if (replaying) {
+          Replay_NextInput(&replayCursor, &tickBits);  // Recorded input instead of the button
         }
-      }
-      
-      // Update and draw obstacles at dynamic speed
-      obstacleFrameCounter++;
-      if (obstacleFrameCounter >= game.currentSpeed) {
-        obstacleFrameCounter = 0;
-        
-        for (int i = 0; i < MAX_OBSTACLES; i++) {
-          if (obstacles[i].active) {
-            // Clear old position
-            clearSprite(obstacles[i].x, obstacles[i].y, 2);
-            
-            // Move obstacle left
-            if (obstacles[i].y > 8) {
-              obstacles[i].y -= 8;
-            
-              // Draw at new position
-              drawCactus(obstacles[i].x, obstacles[i].y, obstacles[i].type);
-            } else {
-              // Obstacle moved off screen
-              obstacles[i].active = 0;
-              // Increase score and print to UART
-              game.score++;
-              // printf("Score: %d\r\n", game.score);
-            }
-          }
+        if (GameCore_Step(&core, tickBits, &deviceIO) == GAME_STEP_OVER) {
+          // No more lives - Game Over
+          gameOver = 1;
+          // printf("\r\n=== GAME OVER ===\r\n");
+          // printf("Final Score: %d\r\n", core.state.score);
+          drawDinoDead(&core.state);  // Dead dino at the collision position
+          drawEndScreen();            // Show END text
         }
-      }
-      
-      // Collision detection (check every frame)
-      for (int i = 0; i < MAX_OBSTACLES; i++) {
-        if (obstacles[i].active) {
-          // Check horizontal overlap first (Y axis = column/horizontal)
-          unsigned char horizontalOverlap = (obstacles[i].y >= game.dinoY - 4 && 
-                                             obstacles[i].y <= game.dinoY + 12);
-          
-          // Check vertical overlap (X axis = page/vertical, lower X = higher on screen)
-          // Dino must be at same level or below obstacle top to collide
-          unsigned char verticalOverlap = (game.dinoX >= obstacles[i].x - 1);
-          
-          if (horizontalOverlap && verticalOverlap) {
-            // Collision! Lose a life
-            game.lives--;
-            // printf("Hit! Lives remaining: %d\r\n", game.lives);
-            updateLivesLED(game.lives);
-            
-            // Deactivate the obstacle that hit us
-            obstacles[i].active = 0;
-            clearSprite(obstacles[i].x, obstacles[i].y, 2);
-            
-            if (game.lives == 0) {
-              // No more lives - Game Over
-              gameOver = 1;
-              // printf("\r\n=== GAME OVER ===\r\n");
-              // printf("Final Score: %d\r\n", game.score);
-              
-              // Draw dead dino sprite at collision position
-              drawDinoDead(&game);
-              
-              drawEndScreen();  // Show END text
-              LCD_SwapBuffers(); // Flush game over screen
-            }
-            break;
-          }
+        if (!replaying) {
+          Replay_Record(&replay, tickBits, core.state.score);
+        } else if (gameOver || Replay_AtEnd(&replayCursor)) {
+          endReplay();
         }
+        inputBits &= ~GAME_INPUT_PRESS;  // A press starts one jump
       }
       
-      // Update lives display on LEDs
-      updateLivesLED(game.lives);
-      
-      // Increase game difficulty over time using PWM
-      updateGameSpeed(&game);
-      
       // ===== DOUBLE BUFFER: Swap and flush only changed pixels =====
-      LCD_SwapBuffers();
+      // Only when the previous frame has gone out: a busy LCD skips this
+      // render instead of stalling the simulation, and the next swap sends
+      // everything drawn since. The game over screen always goes out.
+      if (gameOver || (ticks > 0 && LCD_GetFlushStatus() == LCD_FLUSH_IDLE)) {
+        LCD_SwapBuffers();
+        Sim_CountRender(1);
+      } else if (ticks > 0) {
+        Sim_CountRender(0);
+      }
+      Prof_Mark(PROF_SWAP);
       
-      // Wait for timer interrupt to trigger next frame
-      while (!gameTimerFlag) {
-        // Wait for timer flag
+      if (gameOver) {
+        setClockProfile(CLOCK_PROFILE_MENU);
+        Input_Flush();     // Presses from before the crash do not restart
       }
+      
+      // Sleep until the next simulation tick is due
+      Idle_WaitFlag(&gameTimerFlag);
       gameTimerFlag = 0;  // Clear flag for next frame
+      Prof_Mark(PROF_IDLE);
+      Idle_EndFrame();
+      
+      checkStatsDump();   // Outside every phase; only the frame total sees it
       
     } else {
       // Game over state - wait for button to restart
-      GPIO_PinState buttonState = HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN);
-      if (buttonState == GPIO_PIN_SET) {
-        HAL_Delay(500);  // Debounce
-        
+      Prof_AbortFrame();
+      checkStatsDump();
+      Idle_WaitFlag(&gameTimerFlag);  // Poll the button once per timer tick
+      gameTimerFlag = 0;
+      if (Input_TakePress()) {
         // Restart game - go back to start screen
         clearEndScreen();  // Clear END text
         LCD_Clear();
         LCD_InitFrameBuffer();  // Reset frame buffers
-        initGameState(&game);
-        for (int i = 0; i < MAX_OBSTACLES; i++) {
-          obstacles[i].active = 0;
-        }
         
         // Show start screen again to select lives
         drawStartScreen();
         LCD_SwapBuffers();  // Flush start screen
-        unsigned char selectedLives = 1;
-        updateLivesLED(selectedLives);
+        unsigned char selectedLives = selectLives();
         
-        // Wait for button press while reading ADC to select lives
-        HAL_Delay(300);  // Wait for button release
-        while (HAL_GPIO_ReadPin(BUTTON_PORT, BUTTON_PIN) != GPIO_PIN_SET) {
-          HAL_ADC_Start(&hadc1);
-          HAL_ADC_PollForConversion(&hadc1, 100);
-          uint32_t adcValue = HAL_ADC_GetValue(&hadc1);
-          HAL_ADC_Stop(&hadc1);
-          
-          if (adcValue < 1024) {
-            selectedLives = 1;
-          } else if (adcValue < 2048) {
-            selectedLives = 2;
-          } else if (adcValue < 3072) {
-            selectedLives = 3;
-          } else {
-            selectedLives = 4;
-          }
-          updateLivesLED(selectedLives);
-          HAL_Delay(50);
-        }
-        
-        HAL_Delay(200);  // Debounce
-        game.lives = selectedLives;
+        setClockProfile(CLOCK_PROFILE_DEFAULT);
+        Prng_EntropyAdd(Prof_Now());
+        startGame(selectedLives);  // New obstacle sequence (the same one in deterministic mode)
         // printf("\r\n=== GAME RESTART ===\r\n");
-        // printf("Lives: %d\r\n", game.lives);
-        
-        // Reset timer period to initial speed
-        __HAL_TIM_SET_AUTORELOAD(&htim1, TIMER_PERIOD_INIT);
+        // printf("Lives: %d\r\n", core.state.lives);
         
         clearStartScreen();
         LCD_ClearBuffer();  // Clear frame buffer for new game
         drawGroundLine(0);
         drawStar(0, 20);
         drawMoon(0, 90);
+        LCD_Background_Capture();  // Sprites erase back to this scenery
         LCD_FlushBuffer();  // Initial full flush for static elements
-        frameCount = 0;
-        nextObstacleSpawn = 10;  // First obstacle spawns quickly after restart
         gameOver = 0;
       }
+      Idle_AbortFrame();  // Screen time is not charged to the next game frame
     }
   /* USER CODE END 3 */
   }
@@ -435,44 +445,10 @@ PUTCHAR_PROTOTYPE
 }
 void SystemClock_Config(void)
 {
-
-  RCC_OscInitTypeDef RCC_OscInitStruct;
-  RCC_ClkInitTypeDef RCC_ClkInitStruct;
-  RCC_PeriphCLKInitTypeDef PeriphClkInit;
-
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSICalibrationValue = 16;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
-  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
-  {
-    Error_Handler();
-  }
-
-  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
-                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
-  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
-  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
-  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK)
-  {
-    Error_Handler();
-  }
-
-  PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC;
-  PeriphClkInit.AdcClockSelection = RCC_ADCPCLK2_DIV2;
-  if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK)
-  {
-    Error_Handler();
-  }
-
-  HAL_SYSTICK_Config(HAL_RCC_GetHCLKFreq()/1000);
-
-  HAL_SYSTICK_CLKSourceConfig(SYSTICK_CLKSOURCE_HCLK);
-
-  /* SysTick_IRQn interrupt configuration */
-  HAL_NVIC_SetPriority(SysTick_IRQn, 0, 0);
+  // Oscillator, PLL, flash wait states, bus/ADC prescalers and SysTick for
+  // the chosen profile (clock.h). TIM1, USART1 and the LCD FSMC timing are
+  // initialised afterwards and take their dividers from the new clock.
+  Clock_Config(CLOCK_PROFILE_DEFAULT);
 }
 
 /* ADC1 init function */
@@ -499,7 +475,7 @@ static void MX_ADC1_Init(void)
     */
   sConfig.Channel = ADC_CHANNEL_14;
   sConfig.Rank = 1;
-  sConfig.SamplingTime = ADC_SAMPLETIME_1CYCLE_5;
+  sConfig.SamplingTime = ADC_SAMPLETIME_239CYCLES_5;  // Pot source impedance; DMA keeps up anyway
   if (HAL_ADC_ConfigChannel(&hadc1, &sConfig) != HAL_OK)
   {
     Error_Handler();
@@ -512,8 +488,8 @@ void MX_USART1_UART_Init(void)
 {
 
   huart1.Instance = USART1;
-  huart1.Init.BaudRate = 9600;
-  huart1.Init.WordLength = UART_WORDLENGTH_9B;
+  huart1.Init.BaudRate = 115200;  // 0.6% off at the 8 MHz HSI profile
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;  // Dumps and replays are bytes
   huart1.Init.StopBits = UART_STOPBITS_1;
   huart1.Init.Parity = UART_PARITY_NONE;
   huart1.Init.Mode = UART_MODE_TX_RX;
@@ -529,9 +505,9 @@ void MX_TIM1_Init(void)
   TIM_MasterConfigTypeDef sMasterConfig;
 
   htim1.Instance = TIM1;
-  htim1.Init.Prescaler = 799;  // 8MHz / 800 = 10kHz tick rate
+  htim1.Init.Prescaler = Clock_Tim1Prescaler();  // 10kHz tick rate at any core clock
   htim1.Init.CounterMode = TIM_COUNTERMODE_UP;
-  htim1.Init.Period = TIMER_PERIOD_INIT;  // 10kHz / 100 = 100Hz = 10ms per frame
+  htim1.Init.Period = SIM_TICK_PERIOD;  // 10kHz / 150 = 66.7Hz = 15ms per simulation tick
   htim1.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
   htim1.Init.RepetitionCounter = 0;
   HAL_TIM_Base_Init(&htim1);
@@ -602,12 +578,12 @@ static void MX_GPIO_Init(void)
   BSP_LED_Init(LED3);
 	
 	WAKEUP_BUTTON_GPIO_CLK_ENABLE();
-	GPIO_InitStruct.Mode  = GPIO_MODE_INPUT;
+	GPIO_InitStruct.Mode  = GPIO_MODE_IT_RISING_FALLING;  // Jump button, EXTI0 (input.c)
   GPIO_InitStruct.Pull  = GPIO_NOPULL;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
 	
-	GPIO_InitStruct.Pin = GPIO_PIN_0;
-  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+	GPIO_InitStruct.Pin = BUTTON_PIN;
+  HAL_GPIO_Init(BUTTON_PORT, &GPIO_InitStruct);
 
 	TAMPER_BUTTON_GPIO_CLK_ENABLE();
 	GPIO_InitStruct.Mode  = GPIO_MODE_INPUT;
@@ -620,6 +596,15 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (GPIO_Pin == BUTTON_PIN) Input_EdgeIRQ();
+}
+
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef* hadc)
+{
+  Pot_WatchdogIRQ();
+}
 
 /* USER CODE END 4 */
 
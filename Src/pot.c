@@ -0,0 +1,209 @@
+/**
+ ******************************************************************************
+ * @file    pot.c
+ * @brief   Lives-selection potentiometer: continuous ADC, DMA, watchdog
+ ******************************************************************************
+ *
+ * See pot.h. The DMA channel's interrupt is never enabled in the NVIC and its
+ * interrupt bits are cleared after start; the only ADC interrupt is the
+ * analog watchdog, and that is disarmed in its handler until Pot_Poll() has
+ * moved the window, so a knob held outside the window does not interrupt on
+ * every conversion.
+ *
+ ******************************************************************************
+ */
+
+#include "pot.h"
+
+#define POT_NO_SAMPLE   0xFFFF      // Buffer slot not yet written by the DMA
+#define POT_NO_BUCKET   0xFF
+
+static ADC_HandleTypeDef *potAdc;
+static DMA_HandleTypeDef hdma_pot;
+static volatile uint16_t potSamples[POT_DMA_SAMPLES];
+static volatile unsigned char potMoved = 0;     // Set by the watchdog interrupt
+static volatile unsigned long potWatchdogEvents = 0;
+static unsigned char potBucket = POT_NO_BUCKET;
+
+/*******************************************************************************
+* Function Name  : Pot_SetWindow
+* Description    : Centre the analog watchdog window on a value
+*******************************************************************************/
+static void Pot_SetWindow(uint32_t value)
+{
+  uint32_t low = (value > POT_WATCH_WINDOW) ? value - POT_WATCH_WINDOW : 0;
+  uint32_t high = value + POT_WATCH_WINDOW;
+
+  if (high > POT_FULL_SCALE - 1) high = POT_FULL_SCALE - 1;
+  potAdc->Instance->LTR = low;
+  potAdc->Instance->HTR = high;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_Init
+* Description    : Calibrate ADC1, start continuous conversion into the
+*                  circular DMA buffer and arm the analog watchdog
+* Input          : hadc -- ADC1 handle set up by MX_ADC1_Init()
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Pot_Init(ADC_HandleTypeDef *hadc)
+{
+  ADC_AnalogWDGConfTypeDef awd;
+  unsigned int i;
+
+  potAdc = hadc;
+  for (i = 0; i < POT_DMA_SAMPLES; i++) {
+    potSamples[i] = POT_NO_SAMPLE;
+  }
+
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_pot.Instance = DMA1_Channel1;
+  hdma_pot.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_pot.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_pot.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_pot.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_pot.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_pot.Init.Mode = DMA_CIRCULAR;
+  hdma_pot.Init.Priority = DMA_PRIORITY_LOW;
+  HAL_DMA_Init(&hdma_pot);
+  __HAL_LINKDMA(hadc, DMA_Handle, hdma_pot);
+
+  // Watchdog on the pot channel; the window is placed on the first Pot_Poll()
+  awd.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+  awd.Channel = ADC_CHANNEL_14;
+  awd.ITMode = ENABLE;
+  awd.HighThreshold = POT_FULL_SCALE - 1;
+  awd.LowThreshold = 0;
+  awd.WatchdogNumber = 0;
+  HAL_ADC_AnalogWDGConfig(hadc, &awd);
+
+  HAL_ADCEx_Calibration_Start(hadc);
+  HAL_ADC_Start_DMA(hadc, (uint32_t *)potSamples, POT_DMA_SAMPLES);
+  // HAL_ADC_Start_DMA arms the DMA interrupts; nothing needs them
+  __HAL_DMA_DISABLE_IT(&hdma_pot, DMA_IT_TC | DMA_IT_HT | DMA_IT_TE);
+
+  potBucket = POT_NO_BUCKET;
+  potMoved = 1;             // First Pot_Poll() takes the initial position
+
+  HAL_NVIC_SetPriority(ADC1_2_IRQn, 3, 0);
+  HAL_NVIC_EnableIRQ(ADC1_2_IRQn);
+}
+
+/*******************************************************************************
+* Function Name  : Pot_WatchdogIRQ
+* Description    : The input left the watchdog window. Disarm the watchdog
+*                  and leave the rest to Pot_Poll().
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Pot_WatchdogIRQ(void)
+{
+  __HAL_ADC_DISABLE_IT(potAdc, ADC_IT_AWD);
+  potMoved = 1;
+  potWatchdogEvents++;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_GetFiltered
+* Description    : Average of the DMA buffer (slots the DMA has not reached
+*                  yet are skipped)
+* Input          : None
+* Output         : None
+* Return         : 0 - 4095
+*******************************************************************************/
+uint32_t Pot_GetFiltered(void)
+{
+  uint32_t sum = 0;
+  unsigned int n = 0;
+  unsigned int i;
+
+  for (i = 0; i < POT_DMA_SAMPLES; i++) {
+    uint16_t sample = potSamples[i];
+    if (sample == POT_NO_SAMPLE) continue;
+    sum += sample;
+    n++;
+  }
+  return n ? (sum + n / 2) / n : 0;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_GetLatestSample
+* Description    : Most recent conversion, from the DMA's position in the
+*                  buffer
+* Input          : None
+* Output         : None
+* Return         : Raw 12-bit sample
+*******************************************************************************/
+uint16_t Pot_GetLatestSample(void)
+{
+  uint32_t remaining = __HAL_DMA_GET_COUNTER(&hdma_pot);
+  uint32_t next = POT_DMA_SAMPLES - remaining;        // Slot the DMA writes next
+  uint16_t sample = potSamples[(next + POT_DMA_SAMPLES - 1) % POT_DMA_SAMPLES];
+
+  return (sample == POT_NO_SAMPLE) ? 0 : sample;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_Bucket
+* Description    : Lives bucket of a value. The current bucket is kept until
+*                  the value is POT_HYSTERESIS past one of its edges.
+*******************************************************************************/
+static unsigned char Pot_Bucket(uint32_t value)
+{
+  unsigned char bucket = (unsigned char)(value / POT_BUCKET_WIDTH);
+  uint32_t low, high;
+
+  if (bucket >= POT_LIVES) bucket = POT_LIVES - 1;
+  if (potBucket == POT_NO_BUCKET || bucket == potBucket) return bucket;
+
+  low = (uint32_t)potBucket * POT_BUCKET_WIDTH;
+  high = low + POT_BUCKET_WIDTH;
+  if (value + POT_HYSTERESIS >= low && value < high + POT_HYSTERESIS) return potBucket;
+  return bucket;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_Poll
+* Description    : If the watchdog saw the knob move: filter, re-centre the
+*                  window on the new value, re-arm the watchdog and update
+*                  the lives bucket. Costs nothing while the knob rests.
+* Input          : None
+* Output         : None
+* Return         : 1 -- Pot_GetLives() changed
+*******************************************************************************/
+unsigned char Pot_Poll(void)
+{
+  uint32_t value;
+  unsigned char bucket;
+
+  if (!potMoved) return 0;
+  potMoved = 0;
+
+  value = Pot_GetFiltered();
+  Pot_SetWindow(value);
+  __HAL_ADC_CLEAR_FLAG(potAdc, ADC_FLAG_AWD);
+  __HAL_ADC_ENABLE_IT(potAdc, ADC_IT_AWD);
+
+  bucket = Pot_Bucket(value);
+  if (bucket == potBucket) return 0;
+  potBucket = bucket;
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Pot_GetLives / Pot_GetWatchdogEvents
+* Description    : Selected lives (1 until the first Pot_Poll) / number of
+*                  watchdog interrupts taken
+*******************************************************************************/
+unsigned char Pot_GetLives(void)
+{
+  return (potBucket == POT_NO_BUCKET) ? 1 : (unsigned char)(potBucket + 1);
+}
+
+unsigned long Pot_GetWatchdogEvents(void)
+{
+  return potWatchdogEvents;
+}
@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file    prng.c
+ * @brief   Seeded pseudo-random streams and a seed entropy pool
+ ******************************************************************************
+ *
+ * See prng.h. Seeds, stream numbers and the pool all go through the same
+ * fmix32 finaliser (Prng_Mix), so nearby inputs never give related states.
+ *
+ ******************************************************************************
+ */
+
+#include "prng.h"
+
+static uint32_t entropyPool = 0;
+static uint32_t entropyCount = 0;
+static uint32_t prngLastSeed = 0;
+#ifdef PRNG_FIXED_SEED
+static unsigned char prngFixed = 1;
+static uint32_t prngFixedSeed = PRNG_FIXED_SEED;
+#else
+static unsigned char prngFixed = 0;
+static uint32_t prngFixedSeed = 0;
+#endif
+
+/*******************************************************************************
+* Function Name  : Prng_Mix
+* Description    : 32-bit finaliser (golden-ratio step, MurmurHash3 fmix32):
+*                  every input bit affects every output bit, so nearby seeds
+*                  and stream numbers give unrelated states
+*******************************************************************************/
+static uint32_t Prng_Mix(uint32_t z)
+{
+  z += 0x9E3779B9u;
+  z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+  z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+  return z ^ (z >> 16);
+}
+
+/*******************************************************************************
+* Function Name  : Prng_Seed
+* Description    : Start a stream from a game seed and a stream number
+* Input          : stream -- generator to set, seed -- game seed,
+*                  streamId -- PRNG_STREAM_*
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prng_Seed(PrngStream *stream, uint32_t seed, uint32_t streamId)
+{
+  uint32_t state = Prng_Mix(seed ^ Prng_Mix(streamId));
+
+  stream->state = state ? state : 0x6D2B79F5u;   // xorshift sticks at 0
+}
+
+/*******************************************************************************
+* Function Name  : Prng_Next
+* Description    : Next number of a stream (xorshift32, period 2^32 - 1)
+* Input          : stream -- generator
+* Output         : None
+* Return         : 32 random bits
+*******************************************************************************/
+uint32_t Prng_Next(PrngStream *stream)
+{
+  uint32_t x = stream->state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  stream->state = x;
+  return x;
+}
+
+/*******************************************************************************
+* Function Name  : Prng_Range
+* Description    : Uniform number below n. The product x * n spreads x over
+*                  n equal slices of 2^32; the few x values that would make
+*                  the low slices one larger are rejected and redrawn.
+* Input          : stream -- generator, n -- range size
+* Output         : None
+* Return         : 0 - n-1
+*******************************************************************************/
+uint32_t Prng_Range(PrngStream *stream, uint32_t n)
+{
+  uint64_t m;
+  uint32_t low;
+
+  if (n == 0) return 0;
+  m = (uint64_t)Prng_Next(stream) * n;
+  low = (uint32_t)m;
+  if (low < n) {
+    uint32_t threshold = (0u - n) % n;      // 2^32 mod n
+    while (low < threshold) {
+      m = (uint64_t)Prng_Next(stream) * n;
+      low = (uint32_t)m;
+    }
+  }
+  return (uint32_t)(m >> 32);
+}
+
+/*******************************************************************************
+* Function Name  : Prng_EntropyAdd
+* Description    : Fold a noisy value into the pool. Cheap enough for an
+*                  interrupt handler; values with little entropy do no harm.
+* Input          : sample -- e.g. ADC reading, cycle counter, SysTick->VAL
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prng_EntropyAdd(uint32_t sample)
+{
+  uint32_t x = entropyPool ^ sample;
+
+  entropyPool = ((x << 7) | (x >> 25)) * 0x9E3779B1u + 0x7F4A7C15u;
+  entropyCount++;
+}
+
+/*******************************************************************************
+* Function Name  : Prng_GameSeed
+* Description    : Seed for a new game. In deterministic mode the fixed seed;
+*                  otherwise the mixed pool, which is then stirred so the
+*                  next game differs even without new samples.
+* Input          : None
+* Output         : None
+* Return         : Seed for Prng_Seed()
+*******************************************************************************/
+uint32_t Prng_GameSeed(void)
+{
+  if (prngFixed) {
+    prngLastSeed = prngFixedSeed;
+  } else {
+    prngLastSeed = Prng_Mix(entropyPool ^ Prng_Mix(entropyCount));
+    Prng_EntropyAdd(prngLastSeed);
+  }
+  return prngLastSeed;
+}
+
+/*******************************************************************************
+* Function Name  : Prng_SetFixedSeed / Prng_ClearFixedSeed / Prng_GetLastSeed
+* Description    : Deterministic mode on / off; the seed last handed out
+*******************************************************************************/
+void Prng_SetFixedSeed(uint32_t seed)
+{
+  prngFixedSeed = seed;
+  prngFixed = 1;
+}
+
+void Prng_ClearFixedSeed(void)
+{
+  prngFixed = 0;
+}
+
+uint32_t Prng_GetLastSeed(void)
+{
+  return prngLastSeed;
+}
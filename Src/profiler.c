@@ -0,0 +1,307 @@
+/**
+ ******************************************************************************
+ * @file    profiler.c
+ * @brief   Frame-phase profiler for the main loop (DWT cycle counter)
+ ******************************************************************************
+ *
+ * See profiler.h for usage. On the MCU the tick source is the Cortex-M3 DWT
+ * cycle counter; with HOST_BUILD it is CLOCK_MONOTONIC in nanoseconds.
+ *
+ ******************************************************************************
+ */
+
+#ifdef HOST_BUILD
+#define _POSIX_C_SOURCE 199309L   // clock_gettime() under -std=c99, before any include
+#endif
+
+#include "profiler.h"
+#include "fmt.h"
+
+#ifdef HOST_BUILD
+#include <time.h>
+#endif
+
+static ProfStats profStats[PROF_PHASES];
+static uint32_t profFrameTicks[PROF_PHASES];    // Per-phase totals of the open frame
+static unsigned char profMarked[PROF_PHASES];   // Phase seen in the open frame
+static uint32_t profFrameStart;
+static uint32_t profLastMark;
+static unsigned char profFrameOpen = 0;
+static uint32_t profTicksPerUs = 1;              // Tick rate of the recorded frames
+
+/*******************************************************************************
+* Function Name  : Prof_Init
+* Description    : Start the tick source and clear all statistics
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_Init(void)
+{
+#ifndef HOST_BUILD
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // Enable the DWT block
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  Prof_Reset();
+  profTicksPerUs = Prof_TicksPerUs();
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Now
+* Description    : Current tick count. Wraps; use unsigned differences.
+* Input          : None
+* Output         : None
+* Return         : Ticks
+*******************************************************************************/
+uint32_t Prof_Now(void)
+{
+#ifdef HOST_BUILD
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+#else
+  return DWT->CYCCNT;
+#endif
+}
+
+/*******************************************************************************
+* Function Name  : Prof_TicksPerUs
+* Description    : Current tick rate, for turning the numbers into time
+* Input          : None
+* Output         : None
+* Return         : Ticks per microsecond
+*******************************************************************************/
+uint32_t Prof_TicksPerUs(void)
+{
+#ifdef HOST_BUILD
+  return 1000;
+#else
+  return SystemCoreClock / 1000000;
+#endif
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Bucket
+* Description    : Power-of-two histogram bucket of a tick count
+*******************************************************************************/
+static unsigned char Prof_Bucket(uint32_t ticks)
+{
+  unsigned char bucket = 0;
+
+  while (ticks && bucket < PROF_BUCKETS - 1) {
+    ticks >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Record
+* Description    : Add one frame's value to a phase
+*******************************************************************************/
+static void Prof_Record(unsigned char phase, uint32_t ticks)
+{
+  ProfStats *s = &profStats[phase];
+
+  if (s->count == 0 || ticks < s->min) s->min = ticks;
+  if (ticks > s->max) s->max = ticks;
+  s->total += ticks;
+  s->count++;
+  s->hist[Prof_Bucket(ticks)]++;
+}
+
+/*******************************************************************************
+* Function Name  : Prof_BeginFrame
+* Description    : Record the open frame (every phase marked in it, plus
+*                  PROF_FRAME) and start a new one
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_BeginFrame(void)
+{
+  uint32_t now = Prof_Now();
+  unsigned char p;
+
+  if (profFrameOpen) {
+    for (p = 0; p < PROF_FRAME; p++) {
+      if (profMarked[p]) Prof_Record(p, profFrameTicks[p]);
+    }
+    Prof_Record(PROF_FRAME, now - profFrameStart);
+  }
+
+  for (p = 0; p < PROF_PHASES; p++) {
+    profFrameTicks[p] = 0;
+    profMarked[p] = 0;
+  }
+  profFrameStart = now;
+  profLastMark = now;
+  profFrameOpen = 1;
+  profTicksPerUs = Prof_TicksPerUs();   // The core clock may change between frames
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Mark
+* Description    : Charge the ticks since the previous mark to a phase
+* Input          : phase -- PROF_INPUT ... PROF_IDLE
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_Mark(unsigned char phase)
+{
+  uint32_t now = Prof_Now();
+
+  if (!profFrameOpen || phase >= PROF_FRAME) return;
+  profFrameTicks[phase] += now - profLastMark;
+  profMarked[phase] = 1;
+  profLastMark = now;
+}
+
+/*******************************************************************************
+* Function Name  : Prof_AbortFrame
+* Description    : Close the open frame without recording it, so time spent
+*                  outside the game loop does not show up as one long frame
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_AbortFrame(void)
+{
+  profFrameOpen = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Reset
+* Description    : Clear all statistics
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_Reset(void)
+{
+  unsigned char p, b;
+
+  for (p = 0; p < PROF_PHASES; p++) {
+    profStats[p].count = 0;
+    profStats[p].min = 0;
+    profStats[p].max = 0;
+    profStats[p].total = 0;
+    for (b = 0; b < PROF_BUCKETS; b++) {
+      profStats[p].hist[b] = 0;
+    }
+  }
+  profFrameOpen = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Prof_GetStats
+* Description    : Copy one phase's statistics
+* Input          : phase -- PROF_* index, stats -- destination
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_GetStats(unsigned char phase, ProfStats *stats)
+{
+  if (phase < PROF_PHASES) *stats = profStats[phase];
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Percentile
+* Description    : Upper bound of the histogram bucket that holds the given
+*                  percentile (so accurate to a factor of two)
+* Input          : phase -- PROF_* index, percent -- 0-100
+* Output         : None
+* Return         : Ticks, 0 when nothing was recorded
+*******************************************************************************/
+uint32_t Prof_Percentile(unsigned char phase, unsigned char percent)
+{
+  const ProfStats *s;
+  uint64_t target, seen = 0;
+  unsigned char b;
+
+  if (phase >= PROF_PHASES) return 0;
+  s = &profStats[phase];
+  if (s->count == 0) return 0;
+
+  target = ((uint64_t)s->count * percent + 99) / 100;
+  if (target == 0) target = 1;
+  for (b = 0; b < PROF_BUCKETS; b++) {
+    seen += s->hist[b];
+    if (seen >= target) break;
+  }
+  if (b >= PROF_BUCKETS - 1) return s->max;
+  return b == 0 ? 0 : (uint32_t)((1UL << b) - 1);
+}
+
+/*******************************************************************************
+* Function Name  : Prof_IdlePermille
+* Description    : Headroom - share of the frame time spent waiting for the
+*                  frame timer
+* Input          : None
+* Output         : None
+* Return         : Idle ticks per 1000 frame ticks
+*******************************************************************************/
+uint32_t Prof_IdlePermille(void)
+{
+  if (profStats[PROF_FRAME].total == 0) return 0;
+  return (uint32_t)(profStats[PROF_IDLE].total * 1000 / profStats[PROF_FRAME].total);
+}
+
+/*******************************************************************************
+* Function Name  : Prof_Dump
+* Description    : Write the profile as text, one line per phase:
+*                    swap n=1200 min=310 avg=402 max=2210 p50=511 p90=1023 p99=2047
+*                  followed by the idle headroom. Values are in ticks, at the
+*                  clock the frames ran at (not necessarily the current one).
+* Input          : write -- called once per line (e.g. a UART transmit)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Prof_Dump(void (*write)(const char *text, unsigned int length))
+{
+  static const char *names[PROF_PHASES] = {
+    "input", "draw", "jump", "anim", "spawn", "obstacles",
+    "collision", "leds", "speed", "swap", "idle", "frame"
+  };
+  char line[128];
+  unsigned int pos;
+  unsigned char p;
+  uint32_t permille;
+
+  pos = Fmt_AppendText(line, 0, "Profile ticks/us=");
+  pos = Fmt_AppendUInt(line, pos, profTicksPerUs);
+  pos = Fmt_AppendText(line, pos, "\r\n");
+  write(line, pos);
+
+  for (p = 0; p < PROF_PHASES; p++) {
+    const ProfStats *s = &profStats[p];
+
+    if (s->count == 0) continue;
+    pos = Fmt_AppendText(line, 0, names[p]);
+    pos = Fmt_AppendText(line, pos, " n=");
+    pos = Fmt_AppendUInt(line, pos, s->count);
+    pos = Fmt_AppendText(line, pos, " min=");
+    pos = Fmt_AppendUInt(line, pos, s->min);
+    pos = Fmt_AppendText(line, pos, " avg=");
+    pos = Fmt_AppendUInt(line, pos, (uint32_t)(s->total / s->count));
+    pos = Fmt_AppendText(line, pos, " max=");
+    pos = Fmt_AppendUInt(line, pos, s->max);
+    pos = Fmt_AppendText(line, pos, " p50=");
+    pos = Fmt_AppendUInt(line, pos, Prof_Percentile(p, 50));
+    pos = Fmt_AppendText(line, pos, " p90=");
+    pos = Fmt_AppendUInt(line, pos, Prof_Percentile(p, 90));
+    pos = Fmt_AppendText(line, pos, " p99=");
+    pos = Fmt_AppendUInt(line, pos, Prof_Percentile(p, 99));
+    pos = Fmt_AppendText(line, pos, "\r\n");
+    write(line, pos);
+  }
+
+  permille = Prof_IdlePermille();
+  pos = Fmt_AppendText(line, 0, "headroom=");
+  pos = Fmt_AppendUInt(line, pos, permille / 10);
+  line[pos++] = '.';
+  pos = Fmt_AppendUInt(line, pos, permille % 10);
+  pos = Fmt_AppendText(line, pos, "%\r\n");
+  write(line, pos);
+}
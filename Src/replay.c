@@ -0,0 +1,327 @@
+/**
+ ******************************************************************************
+ * @file    replay.c
+ * @brief   Game session recording and tick-exact playback
+ ******************************************************************************
+ *
+ * See replay.h. The parser is a token state machine fed one character at a
+ * time, so it can run straight off the USART with no line buffer; the END
+ * tick count is checked against the runs to catch lost characters.
+ *
+ ******************************************************************************
+ */
+
+#include "replay.h"
+#include "fmt.h"
+
+#define REPLAY_INPUT_MASK     (GAME_INPUT_BUTTON | GAME_INPUT_PRESS)
+#define REPLAY_RUNS_PER_LINE  16
+
+// Parser states, in text order
+#define PARSE_MAGIC           0
+#define PARSE_VERSION         1
+#define PARSE_SEED            2
+#define PARSE_LIVES           3
+#define PARSE_RUNS            4       // Runs until "END"
+#define PARSE_FRAMES          5
+#define PARSE_SCORE           6
+#define PARSE_DONE            7
+#define PARSE_ERROR           8
+
+/*******************************************************************************
+* Function Name  : Replay_Begin
+* Description    : Start recording a game
+* Input          : replay -- recording to reset, seed -- the game's seed,
+*                  lives -- lives chosen on the pot
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Replay_Begin(Replay *replay, uint32_t seed, unsigned char lives)
+{
+  replay->seed = seed;
+  replay->lives = lives;
+  replay->truncated = 0;
+  replay->runCount = 0;
+  replay->ticks = 0;
+  replay->score = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_Record
+* Description    : Append one tick: extend the last run if the input is
+*                  unchanged, else open a new run. When the runs are full the
+*                  recording stops, so it stays a valid prefix of the game.
+* Input          : replay -- recording, input -- the tick's GAME_INPUT_* bits,
+*                  score -- score after the tick
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Replay_Record(Replay *replay, unsigned char input, uint32_t score)
+{
+  uint16_t *last = replay->runCount ? &replay->runs[replay->runCount - 1] : 0;
+
+  if (replay->truncated) return;
+  input &= REPLAY_INPUT_MASK;
+  if (last && (*last >> REPLAY_RUN_BITS) == input && (*last & REPLAY_RUN_MAX) < REPLAY_RUN_MAX) {
+    (*last)++;
+  } else if (replay->runCount < REPLAY_MAX_RUNS) {
+    replay->runs[replay->runCount++] = (uint16_t)((input << REPLAY_RUN_BITS) | 1);
+  } else {
+    replay->truncated = 1;
+    return;
+  }
+  replay->ticks++;
+  replay->score = score;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_Rewind
+* Description    : Point a cursor at the first tick of a recording
+*******************************************************************************/
+void Replay_Rewind(ReplayCursor *cursor, const Replay *replay)
+{
+  cursor->replay = replay;
+  cursor->run = 0;
+  cursor->used = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_NextInput
+* Description    : Input bits of the next recorded tick
+* Input          : cursor -- playback position
+* Output         : input -- GAME_INPUT_* bits (unchanged at the end)
+* Return         : 1 -- a tick was played, 0 -- the recording is over
+*******************************************************************************/
+unsigned char Replay_NextInput(ReplayCursor *cursor, unsigned char *input)
+{
+  uint16_t run;
+
+  if (Replay_AtEnd(cursor)) return 0;
+  run = cursor->replay->runs[cursor->run];
+  *input = (unsigned char)(run >> REPLAY_RUN_BITS);
+  if (++cursor->used >= (run & REPLAY_RUN_MAX)) {
+    cursor->run++;
+    cursor->used = 0;
+  }
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_AtEnd / Replay_Check
+* Description    : All recorded ticks played / a playback ended where the
+*                  recording did: same tick count, same score
+*******************************************************************************/
+unsigned char Replay_AtEnd(const ReplayCursor *cursor)
+{
+  return cursor->run >= cursor->replay->runCount;
+}
+
+unsigned char Replay_Check(const Replay *replay, uint32_t ticks, uint32_t score)
+{
+  return ticks == replay->ticks && score == replay->score;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_Run
+* Description    : Play a whole recording through GameCore_Step()
+* Input          : replay -- recording, core -- game to run it in,
+*                  io -- side effects (NULL members for headless runs)
+* Output         : core -- the game as of the last recorded tick
+* Return         : 1 -- it ended with the recorded tick count and score
+*******************************************************************************/
+unsigned char Replay_Run(const Replay *replay, GameCore *core, const GameIO *io)
+{
+  ReplayCursor cursor;
+  unsigned char input = 0;
+
+  Replay_Rewind(&cursor, replay);
+  GameCore_Init(core, replay->seed, replay->lives);
+  while (Replay_NextInput(&cursor, &input)) {
+    GameCore_Step(core, input, io);
+  }
+  return Replay_Check(replay, core->tickCount, core->state.score);
+}
+
+/*******************************************************************************
+* Function Name  : Replay_Dump
+* Description    : Write a recording in the text format of replay.h
+* Input          : replay -- recording, write -- output, e.g. to USART1
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Replay_Dump(const Replay *replay, void (*write)(const char *text, unsigned int length))
+{
+  char line[REPLAY_RUNS_PER_LINE * 5 + 2];
+  unsigned int pos;
+  unsigned int i;
+
+  pos = Fmt_AppendText(line, 0, "RPLY ");
+  pos = Fmt_AppendHex(line, pos, REPLAY_VERSION, 1);
+  line[pos++] = ' ';
+  pos = Fmt_AppendHex(line, pos, replay->seed, 8);
+  line[pos++] = ' ';
+  pos = Fmt_AppendHex(line, pos, replay->lives, 2);
+  line[pos++] = '\r';
+  line[pos++] = '\n';
+  write(line, pos);
+
+  pos = 0;
+  for (i = 0; i < replay->runCount; i++) {
+    pos = Fmt_AppendHex(line, pos, replay->runs[i], 4);
+    if ((i + 1) % REPLAY_RUNS_PER_LINE == 0 || i + 1 == replay->runCount) {
+      line[pos++] = '\r';
+      line[pos++] = '\n';
+      write(line, pos);
+      pos = 0;
+    } else {
+      line[pos++] = ' ';
+    }
+  }
+
+  pos = Fmt_AppendText(line, 0, "END ");
+  pos = Fmt_AppendHex(line, pos, replay->ticks, 8);
+  line[pos++] = ' ';
+  pos = Fmt_AppendHex(line, pos, replay->score, 8);
+  line[pos++] = '\r';
+  line[pos++] = '\n';
+  write(line, pos);
+}
+
+/*******************************************************************************
+* Function Name  : Replay_ParseHex
+* Description    : Value of a token of 1-8 hex digits
+* Return         : 1 -- valid
+*******************************************************************************/
+static unsigned char Replay_ParseHex(const char *token, unsigned char length, uint32_t *value)
+{
+  uint32_t v = 0;
+  unsigned char i;
+
+  if (length == 0 || length > 8) return 0;
+  for (i = 0; i < length; i++) {
+    char c = token[i];
+    if (c >= '0' && c <= '9') v = (v << 4) | (uint32_t)(c - '0');
+    else if (c >= 'A' && c <= 'F') v = (v << 4) | (uint32_t)(c - 'A' + 10);
+    else if (c >= 'a' && c <= 'f') v = (v << 4) | (uint32_t)(c - 'a' + 10);
+    else return 0;
+  }
+  *value = v;
+  return 1;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_ParseToken
+* Description    : Take one complete token in the current parser state
+* Return         : Next parser state
+*******************************************************************************/
+static unsigned char Replay_ParseToken(ReplayParser *parser)
+{
+  Replay *replay = parser->replay;
+  const char *token = parser->token;
+  unsigned char length = parser->length;
+  uint32_t value;
+  uint32_t ticks;
+  unsigned int i;
+
+  switch (parser->state) {
+  case PARSE_MAGIC:
+    if (length == 4 && token[0] == 'R' && token[1] == 'P' && token[2] == 'L' && token[3] == 'Y') {
+      Replay_Begin(replay, 0, 0);
+      return PARSE_VERSION;
+    }
+    return PARSE_MAGIC;                 // Skip anything before the header
+  case PARSE_VERSION:
+    if (!Replay_ParseHex(token, length, &value) || value != REPLAY_VERSION) return PARSE_ERROR;
+    return PARSE_SEED;
+  case PARSE_SEED:
+    if (!Replay_ParseHex(token, length, &value)) return PARSE_ERROR;
+    replay->seed = value;
+    return PARSE_LIVES;
+  case PARSE_LIVES:
+    if (!Replay_ParseHex(token, length, &value) || value == 0 || value > 0xFF) return PARSE_ERROR;
+    replay->lives = (unsigned char)value;
+    return PARSE_RUNS;
+  case PARSE_RUNS:
+    if (length == 3 && token[0] == 'E' && token[1] == 'N' && token[2] == 'D') return PARSE_FRAMES;
+    if (length != 4 || !Replay_ParseHex(token, length, &value)) return PARSE_ERROR;
+    if ((value & REPLAY_RUN_MAX) == 0 || replay->runCount >= REPLAY_MAX_RUNS) return PARSE_ERROR;
+    replay->runs[replay->runCount++] = (uint16_t)value;
+    return PARSE_RUNS;
+  case PARSE_FRAMES:
+    if (!Replay_ParseHex(token, length, &value)) return PARSE_ERROR;
+    // The runs must add up to the tick count - catches lost characters
+    ticks = 0;
+    for (i = 0; i < replay->runCount; i++) {
+      ticks += replay->runs[i] & REPLAY_RUN_MAX;
+    }
+    if (ticks != value) return PARSE_ERROR;
+    replay->ticks = value;
+    return PARSE_SCORE;
+  case PARSE_SCORE:
+    if (!Replay_ParseHex(token, length, &value)) return PARSE_ERROR;
+    replay->score = value;
+    return PARSE_DONE;
+  default:
+    return parser->state;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : Replay_ParserInit
+* Description    : Start parsing a recording's text into replay
+*******************************************************************************/
+void Replay_ParserInit(ReplayParser *parser, Replay *replay)
+{
+  parser->replay = replay;
+  parser->state = PARSE_MAGIC;
+  parser->length = 0;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_ParseChar
+* Description    : Feed one character of the text form, e.g. straight from
+*                  the USART. Text before "RPLY" is ignored.
+* Input          : parser -- parser state, c -- next character
+* Output         : None
+* Return         : REPLAY_PARSE_MORE, REPLAY_PARSE_DONE (the replay is
+*                  complete) or REPLAY_PARSE_ERROR
+*******************************************************************************/
+unsigned char Replay_ParseChar(ReplayParser *parser, char c)
+{
+  if (parser->state == PARSE_DONE) return REPLAY_PARSE_DONE;
+  if (parser->state == PARSE_ERROR) return REPLAY_PARSE_ERROR;
+
+  if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+    if (parser->length) {
+      parser->state = Replay_ParseToken(parser);
+      parser->length = 0;
+    }
+  } else if (parser->length < sizeof(parser->token)) {
+    parser->token[parser->length++] = c;
+  } else if (parser->state != PARSE_MAGIC) {
+    parser->state = PARSE_ERROR;        // No valid token is this long
+  }
+
+  if (parser->state == PARSE_DONE) return REPLAY_PARSE_DONE;
+  if (parser->state == PARSE_ERROR) return REPLAY_PARSE_ERROR;
+  return REPLAY_PARSE_MORE;
+}
+
+/*******************************************************************************
+* Function Name  : Replay_ParseEnd
+* Description    : The input stopped (e.g. receive timeout). A recording that
+*                  was started but not completed is cleared, so it is never
+*                  played half-read.
+* Input          : parser -- parser state
+* Output         : None
+* Return         : REPLAY_PARSE_DONE, REPLAY_PARSE_ERROR, or REPLAY_PARSE_MORE
+*                  when no recording was seen at all (replay untouched)
+*******************************************************************************/
+unsigned char Replay_ParseEnd(ReplayParser *parser)
+{
+  if (parser->state == PARSE_DONE) return REPLAY_PARSE_DONE;
+  if (parser->state == PARSE_MAGIC) return REPLAY_PARSE_MORE;
+  Replay_Begin(parser->replay, 0, 0);
+  parser->state = PARSE_ERROR;
+  return REPLAY_PARSE_ERROR;
+}
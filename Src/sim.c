@@ -0,0 +1,120 @@
+/**
+ ******************************************************************************
+ * @file    sim.c
+ * @brief   Fixed-timestep simulation clock and render pacing
+ ******************************************************************************
+ *
+ * See sim.h. The interrupt only increments simTicksDue; the main loop keeps
+ * its own count of ticks taken, so nothing is read-modify-written on both
+ * sides.
+ *
+ ******************************************************************************
+ */
+
+#include "sim.h"
+#include "fmt.h"
+
+static volatile uint32_t simTicksDue = 0;   // Written by the TIM1 interrupt only
+static uint32_t simTicksTaken = 0;
+static SimStats simStats;
+
+/*******************************************************************************
+* Function Name  : Sim_TickIRQ
+* Description    : One simulation tick has passed
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Sim_TickIRQ(void)
+{
+  simTicksDue++;
+}
+
+/*******************************************************************************
+* Function Name  : Sim_Reset
+* Description    : Treat every tick so far as taken, e.g. when a game starts
+*                  after the menu. Statistics are kept.
+* Input          : None
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Sim_Reset(void)
+{
+  simTicksTaken = simTicksDue;
+}
+
+/*******************************************************************************
+* Function Name  : Sim_TakeTicks
+* Description    : Ticks that came due since the last call, at most
+*                  SIM_MAX_CATCHUP (the rest are dropped)
+* Input          : None
+* Output         : None
+* Return         : Number of GameCore_Step() calls to make now
+*******************************************************************************/
+uint32_t Sim_TakeTicks(void)
+{
+  uint32_t due = simTicksDue;
+  uint32_t n = due - simTicksTaken;
+
+  simTicksTaken = due;
+  if (n > SIM_MAX_CATCHUP) {
+    simStats.ticksDropped += n - SIM_MAX_CATCHUP;
+    n = SIM_MAX_CATCHUP;
+  }
+  simStats.ticks += n;
+  if (n > simStats.maxBatch) simStats.maxBatch = n;
+  return n;
+}
+
+/*******************************************************************************
+* Function Name  : Sim_CountRender
+* Description    : Record whether the ticks just run were sent to the LCD
+* Input          : rendered -- 1: swapped, 0: skipped (flush still busy)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Sim_CountRender(unsigned char rendered)
+{
+  if (rendered) {
+    simStats.renders++;
+  } else {
+    simStats.rendersSkipped++;
+  }
+}
+
+/*******************************************************************************
+* Function Name  : Sim_GetStats
+* Description    : Copy of the counters
+*******************************************************************************/
+void Sim_GetStats(SimStats *stats)
+{
+  *stats = simStats;
+}
+
+/*******************************************************************************
+* Function Name  : Sim_Dump
+* Description    : Write the counters as one line of text:
+*                    sim ticks=8000 dropped=0 renders=7400 skipped=600 batch=2
+* Input          : write -- called once per line (e.g. a UART transmit)
+* Output         : None
+* Return         : None
+*******************************************************************************/
+void Sim_Dump(void (*write)(const char *text, unsigned int length))
+{
+  char line[96];
+  unsigned int pos = 0;
+
+  pos = Fmt_AppendText(line, pos, "sim ticks=");
+  pos = Fmt_AppendUInt(line, pos, simStats.ticks);
+  pos = Fmt_AppendText(line, pos, " dropped=");
+  pos = Fmt_AppendUInt(line, pos, simStats.ticksDropped);
+  pos = Fmt_AppendText(line, pos, " renders=");
+  pos = Fmt_AppendUInt(line, pos, simStats.renders);
+  pos = Fmt_AppendText(line, pos, " skipped=");
+  pos = Fmt_AppendUInt(line, pos, simStats.rendersSkipped);
+  pos = Fmt_AppendText(line, pos, " batch=");
+  pos = Fmt_AppendUInt(line, pos, simStats.maxBatch);
+  line[pos++] = '\r';
+  line[pos++] = '\n';
+  write(line, pos);
+}
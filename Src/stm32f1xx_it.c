@@ -42,6 +42,8 @@
 #include "stm32f1xx.h"
 #include "stm32f1xx_it.h"
 #include "stm32f103xg.h"
+#include "input.h"
+#include "sim.h"
 
 /** @addtogroup STM32F1xx_HAL_Examples
   * @{
@@ -55,12 +57,14 @@
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
-volatile unsigned char gameTimerFlag = 0;  // Set by timer interrupt for game frame timing
+volatile unsigned char gameTimerFlag = 0;  // Set by timer interrupt on every simulation tick
 
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
 extern TIM_HandleTypeDef htim1;
+extern DMA_HandleTypeDef hdma_lcd;
+extern ADC_HandleTypeDef hadc1;
 
 /******************************************************************************/
 /*            Cortex-M3 Processor Exceptions Handlers                         */
@@ -163,6 +167,7 @@ void SysTick_Handler(void)
 {
   HAL_IncTick();
 	HAL_SYSTICK_IRQHandler();
+	Input_TickIRQ();  // Button debounce lockout
 }
 
 void TIM1_UP_IRQHandler(void)
@@ -170,10 +175,41 @@ void TIM1_UP_IRQHandler(void)
 	// Clear the interrupt flag
 	HAL_TIM_IRQHandler(&htim1);
 	
-	// Set flag for game loop to process next frame
+	// Count the simulation tick and wake the game loop
+	Sim_TickIRQ();
 	gameTimerFlag = 1;
 }	
 
+/**
+  * @brief  This function handles EXTI line 0 (jump button) interrupt.
+  * @param  None
+  * @retval None
+  */
+void EXTI0_IRQHandler(void)
+{
+	HAL_GPIO_EXTI_IRQHandler(BUTTON_PIN);
+}
+
+/**
+  * @brief  This function handles ADC1/ADC2 (pot analog watchdog) interrupt.
+  * @param  None
+  * @retval None
+  */
+void ADC1_2_IRQHandler(void)
+{
+	HAL_ADC_IRQHandler(&hadc1);
+}
+
+/**
+  * @brief  This function handles DMA2 channel 1 (LCD flush) interrupt.
+  * @param  None
+  * @retval None
+  */
+void DMA2_Channel1_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_lcd);
+}
+
 
 /******************************************************************************/
 /*                 STM32F1xx Peripherals Interrupt Handlers                   */